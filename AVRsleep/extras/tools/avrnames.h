@@ -0,0 +1,44 @@
+#ifndef AVRNAMES_H
+#define AVRNAMES_H
+
+/*============================================================
+ * Names for printing, shared by the host tools.
+ *===========================================================*/
+
+#include <stdint.h>
+#include "AVR_sleepTypes.h"
+
+
+//-------------------------------------------------------------
+// Wake up source names, by wakeSource_t. Anything else is
+// "None" if it's the trace format's no source value.
+//-------------------------------------------------------------
+inline const char *sourceName(const uint8_t source) {
+	static const char *names[sleep::WAKE_SOURCES] = {
+	    "WDT", "PCINT0", "PCINT1", "PCINT2", "INT0", "INT1",
+	    "TWI", "USART", "ADC", "EEPROM", "SPI", "Timer 2",
+	    "Timer 0/1", "Other"
+	};
+
+	if (source < sleep::WAKE_SOURCES) {
+	    return names[source];
+	}
+
+	return source == 0x0F ? "None" : "Unknown";
+}
+
+//-------------------------------------------------------------
+// powerMode_t bit names, by bit number. PRR bits in the low
+// byte, the rest in the high byte.
+//-------------------------------------------------------------
+inline const char *powerBitName(const uint8_t bit) {
+	static const char *names[16] = {
+	    "ADC", "USART", "SPI", "Timer 1", nullptr, "Timer 0",
+	    "Timer 2", "TWI", "AC", "BOD", "WDT", nullptr,
+	    nullptr, nullptr, nullptr, nullptr
+	};
+
+	return bit < 16 ? names[bit] : nullptr;
+}
+
+#endif // AVRNAMES_H
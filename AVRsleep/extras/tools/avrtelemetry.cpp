@@ -0,0 +1,201 @@
+/*============================================================
+ * avrtelemetry - decode AVR_telemetry frames from a capture of
+ * the serial port, or straight from the port itself.
+ *
+ * Usage: avrtelemetry [--delta] [--raw] [file]
+ *
+ *  --delta     Show counts as changes since the last frame,
+ *              rather than the running totals.
+ *  --raw       Show the bytes of each frame as hex too.
+ *
+ * With no file, or a file of "-", standard input is read. To
+ * read a serial port, set it to raw mode first, for example:
+ *
+ *  stty -F /dev/ttyUSB0 9600 raw
+ *  avrtelemetry /dev/ttyUSB0
+ *
+ * Frames are found by their sync byte and checked with their
+ * CRC, so anything else on the line, and damaged frames, are
+ * skipped. Gaps in the sequence numbers are reported as lost
+ * frames. Build with the Makefile alongside.
+ *===========================================================*/
+
+#include <cstdio>
+#include <cstring>
+
+#include "AVR_telemetryFormat.h"
+#include "AVR_energy.h"
+#include "avrnames.h"
+
+using namespace sleep;
+
+
+//-------------------------------------------------------------
+// Print the names of the bits set in a mask.
+//-------------------------------------------------------------
+static void printBits(const uint16_t bits, const char *(*name)(const uint8_t)) {
+	bool first = true;
+
+	for (uint8_t bit = 0; bit < 16; bit++) {
+	    if (!(bits & (1 << bit))) {
+	        continue;
+	    }
+
+	    const char *n = name(bit);
+	    printf("%s%s", first ? "" : ", ", n ? n : "?");
+	    first = false;
+	}
+
+	printf("%s\n", first ? "none" : "");
+}
+
+//-------------------------------------------------------------
+// One frame. Gaps in the sequence numbers since the previous
+// frame, if there was one, are reported. Counts are shown as
+// they are, or with showDelta, as the change since the previous
+// frame, which wraps at 65,536.
+//-------------------------------------------------------------
+static void printFrame(const telemetryFrame_t &frame,
+                       const telemetryFrame_t *previous,
+                       const bool showDelta,
+                       const bool raw) {
+	printf("Frame %u", frame.seq);
+	if (previous && frame.seq != (uint8_t)(previous->seq + 1)) {
+	    printf(" (%u lost)", (uint8_t)(frame.seq - previous->seq - 1));
+	}
+	printf("\n");
+
+	if (raw) {
+	    const uint8_t *bytes = (const uint8_t *)&frame;
+	    for (size_t i = 0; i < sizeof(telemetryFrame_t); i++) {
+	        printf("%s%02X", i % 16 ? " " : "  ", bytes[i]);
+	        if (i % 16 == 15) {
+	            printf("\n");
+	        }
+	    }
+	}
+
+	printf("  Sleep mode:  %s%s\n", modeName(telemetryMode(frame)),
+	       frame.modeFlags & TELEMETRY_LOCKED ? ", locked" : "");
+	printf("  Power off:   ");
+	printBits(frame.powerBits, powerBitName);
+	printf("  Woken by:    ");
+	printBits(frame.wokenBy, sourceName);
+
+	if (!(frame.modeFlags & TELEMETRY_NO_CLOCK)) {
+	    printf("  Clock:       %u\n", (unsigned)frame.clock);
+	    printf("  Last sleep:  %u\n", (unsigned)frame.lastSleep);
+	}
+
+	if (frame.modeFlags & TELEMETRY_NO_STATS) {
+	    printf("  No statistics attached.\n\n");
+	    return;
+	}
+
+	bool delta = showDelta && previous &&
+	             !(previous->modeFlags & TELEMETRY_NO_STATS);
+
+	printf("  %s\n", delta ? "Since the last frame:" : "Counts:");
+	for (uint8_t mode = 0; mode < 8; mode++) {
+	    uint16_t count = frame.sleeps[mode] - (delta ? previous->sleeps[mode] : 0);
+	    if (count) {
+	        printf("    %-22s %6u sleeps\n", modeName(mode), count);
+	    }
+	}
+
+	for (uint8_t source = 0; source < WAKE_SOURCES; source++) {
+	    uint16_t count = frame.wakes[source] - (delta ? previous->wakes[source] : 0);
+	    if (count) {
+	        printf("    %-22s %6u wakes\n", sourceName(source), count);
+	    }
+	}
+
+	uint16_t resleeps = frame.resleeps - (delta ? previous->resleeps : 0);
+	if (resleeps) {
+	    printf("    %-22s %6u\n", "Sent back to sleep", resleeps);
+	}
+
+	printf("\n");
+}
+
+
+int main(int argc, char *argv[]) {
+	bool delta = false;
+	bool raw = false;
+	const char *fileName = "-";
+
+	for (int i = 1; i < argc; i++) {
+	    if (!strcmp(argv[i], "--delta")) {
+	        delta = true;
+	    } else if (!strcmp(argv[i], "--raw")) {
+	        raw = true;
+	    } else if (argv[i][0] == '-' && argv[i][1]) {
+	        fprintf(stderr, "Usage: avrtelemetry [--delta] [--raw] [file]\n");
+	        return 1;
+	    } else {
+	        fileName = argv[i];
+	    }
+	}
+
+	FILE *f = strcmp(fileName, "-") ? fopen(fileName, "rb") : stdin;
+	if (!f) {
+	    perror(fileName);
+	    return 1;
+	}
+
+	//---------------------------------------------------------
+	// Slide a frame sized window along the input. When it holds
+	// a good frame, print it and start afresh, otherwise drop
+	// a byte and look again.
+	//---------------------------------------------------------
+	uint8_t window[sizeof(telemetryFrame_t)];
+	size_t have = 0;
+	telemetryFrame_t frame;
+	telemetryFrame_t last;
+	bool haveLast = false;
+	unsigned long good = 0;
+	unsigned long skipped = 0;
+	int c;
+
+	while ((c = fgetc(f)) != EOF) {
+	    if (!have && c != TELEMETRY_SYNC) {
+	        skipped++;
+	        continue;
+	    }
+
+	    window[have++] = (uint8_t)c;
+	    if (have < sizeof(window)) {
+	        continue;
+	    }
+
+	    memcpy(&frame, window, sizeof(frame));
+	    if (telemetryValid(frame)) {
+	        printFrame(frame, haveLast ? &last : nullptr, delta, raw);
+	        fflush(stdout);
+	        last = frame;
+	        haveLast = true;
+	        good++;
+	        have = 0;
+	        continue;
+	    }
+
+	    //-----------------------------------------------------
+	    // Not a frame. Drop bytes up to the next sync byte.
+	    //-----------------------------------------------------
+	    size_t from = 1;
+	    while (from < have && window[from] != TELEMETRY_SYNC) {
+	        from++;
+	    }
+
+	    skipped += from;
+	    memmove(window, window + from, have - from);
+	    have -= from;
+	}
+
+	if (f != stdin) {
+	    fclose(f);
+	}
+
+	fprintf(stderr, "%lu frames, %lu bytes skipped.\n", good, skipped + have);
+	return 0;
+}
@@ -0,0 +1,333 @@
+/*============================================================
+ * avrtrace - decode an AVR_trace ring from an EEPROM dump, and
+ * report where the time, and the battery, went.
+ *
+ * The dump is either a raw binary EEPROM image, as read by
+ * avrdude with "-U eeprom:r:dump.bin:r", or hex bytes as text,
+ * as a sketch might print them to the serial monitor. In text,
+ * anything ending in a colon, like an address, is skipped.
+ *
+ * Usage: avrtrace [options] dumpfile
+ *
+ *  --base N        EEPROM address of the ring, default 0.
+ *  --records N     Records in the ring, default 248.
+ *  --tick-us N     Microseconds per clock unit, default 1000.
+ *  --active-ua N   Current while awake, default from AVR_energy.h.
+ *  --timeline      List every record, oldest first.
+ *
+ * A dumpfile of "-" reads standard input.
+ *
+ * Build with the Makefile alongside, which uses the library's
+ * own headers for the record format and the energy figures.
+ *===========================================================*/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <vector>
+#include <string>
+
+#include "AVR_sleepTypes.h"
+#include "AVR_traceFormat.h"
+#include "AVR_energy.h"
+#include "avrnames.h"
+
+using namespace sleep;
+
+
+//-------------------------------------------------------------
+// A bucket covers 2^(n-1) to (2^n)-1 units, so take the middle
+// as its typical length.
+//-------------------------------------------------------------
+static double bucketUnits(const uint8_t bucket) {
+	if (!bucket) {
+	    return 0.0;
+	}
+
+	return (traceBucketLow(bucket) + (double)traceBucketHigh(bucket)) / 2.0;
+}
+
+//-------------------------------------------------------------
+// Read the whole dump. It's text if every byte is a hex digit,
+// white space, or part of an address, otherwise binary.
+//-------------------------------------------------------------
+static bool readDump(const char *fileName, std::vector<uint8_t> &bytes) {
+	FILE *f = strcmp(fileName, "-") ? fopen(fileName, "rb") : stdin;
+	if (!f) {
+	    perror(fileName);
+	    return false;
+	}
+
+	std::vector<uint8_t> raw;
+	int c;
+	while ((c = fgetc(f)) != EOF) {
+	    raw.push_back((uint8_t)c);
+	}
+
+	if (f != stdin) {
+	    fclose(f);
+	}
+
+	bool text = !raw.empty();
+	for (size_t i = 0; i < raw.size() && text; i++) {
+	    text = isxdigit(raw[i]) || isspace(raw[i]) ||
+	           raw[i] == ':' || raw[i] == 'x' || raw[i] == 'X';
+	}
+
+	if (!text) {
+	    bytes = raw;
+	    return true;
+	}
+
+	//---------------------------------------------------------
+	// Split into tokens, skip addresses, and read each as hex,
+	// with or without a leading "0x".
+	//---------------------------------------------------------
+	std::string token;
+	raw.push_back(' ');
+	for (size_t i = 0; i < raw.size(); i++) {
+	    if (!isspace(raw[i])) {
+	        token += (char)raw[i];
+	        continue;
+	    }
+
+	    if (token.empty() || token[token.size() - 1] == ':') {
+	        token.clear();
+	        continue;
+	    }
+
+	    char *end;
+	    unsigned long value = strtoul(token.c_str(), &end, 16);
+	    if (*end || value > 0xFF) {
+	        fprintf(stderr, "avrtrace: \"%s\" is not a hex byte.\n", token.c_str());
+	        return false;
+	    }
+
+	    bytes.push_back((uint8_t)value);
+	    token.clear();
+	}
+
+	return true;
+}
+
+//-------------------------------------------------------------
+// Find the oldest record, the same way AVR_trace::begin() finds
+// the next slot to write. Blank slots before it are skipped.
+//-------------------------------------------------------------
+static void oldestFirst(const std::vector<traceRecord_t> &ring,
+                        std::vector<traceRecord_t> &timeline) {
+	size_t next = 0;
+
+	for (size_t slot = 1; slot <= ring.size(); slot++) {
+	    if (slot == ring.size()) {
+	        next = 0;
+	        break;
+	    }
+
+	    if (ring[slot].seq == TRACE_SEQ_BLANK ||
+	        ring[slot].seq != traceNextSeq(ring[slot - 1].seq)) {
+	        next = slot;
+	        break;
+	    }
+	}
+
+	if (!ring.empty() && ring[0].seq == TRACE_SEQ_BLANK) {
+	    next = 0;
+	}
+
+	for (size_t i = 0; i < ring.size(); i++) {
+	    const traceRecord_t &r = ring[(next + i) % ring.size()];
+	    if (r.seq != TRACE_SEQ_BLANK) {
+	        timeline.push_back(r);
+	    }
+	}
+}
+
+static void usage() {
+	fprintf(stderr,
+	        "Usage: avrtrace [--base N] [--records N] [--tick-us N]\n"
+	        "                [--active-ua N] [--timeline] dumpfile\n");
+}
+
+
+int main(int argc, char *argv[]) {
+	unsigned long base = 0;
+	unsigned long records = TRACE_DEFAULT_RECORDS;
+	double tickMicros = 1000.0;
+	double activeMicros = activeMicroamps();
+	bool listing = false;
+	const char *fileName = nullptr;
+
+	//---------------------------------------------------------
+	// Options.
+	//---------------------------------------------------------
+	for (int i = 1; i < argc; i++) {
+	    const char *arg = argv[i];
+	    bool hasValue = i + 1 < argc;
+
+	    if (!strcmp(arg, "--base") && hasValue) {
+	        base = strtoul(argv[++i], nullptr, 0);
+	    } else if (!strcmp(arg, "--records") && hasValue) {
+	        records = strtoul(argv[++i], nullptr, 0);
+	    } else if (!strcmp(arg, "--tick-us") && hasValue) {
+	        tickMicros = atof(argv[++i]);
+	    } else if (!strcmp(arg, "--active-ua") && hasValue) {
+	        activeMicros = atof(argv[++i]);
+	    } else if (!strcmp(arg, "--timeline")) {
+	        listing = true;
+	    } else if (arg[0] == '-' && arg[1]) {
+	        usage();
+	        return 1;
+	    } else {
+	        fileName = arg;
+	    }
+	}
+
+	if (!fileName || !records || records > TRACE_MAX_RECORDS) {
+	    usage();
+	    return 1;
+	}
+
+	std::vector<uint8_t> bytes;
+	if (!readDump(fileName, bytes)) {
+	    return 1;
+	}
+
+	if (base + records * sizeof(traceRecord_t) > bytes.size()) {
+	    fprintf(stderr, "avrtrace: the dump is %zu bytes, too short for %lu records at %lu.\n",
+	            bytes.size(), records, base);
+	    return 1;
+	}
+
+	std::vector<traceRecord_t> ring(records);
+	memcpy(ring.data(), bytes.data() + base, records * sizeof(traceRecord_t));
+
+	std::vector<traceRecord_t> timeline;
+	oldestFirst(ring, timeline);
+
+	if (timeline.empty()) {
+	    printf("No records.\n");
+	    return 0;
+	}
+
+	//---------------------------------------------------------
+	// Rebuild the timeline, and total everything up. Times are
+	// in microseconds, charge in microamp microseconds.
+	//---------------------------------------------------------
+	double modeTime[8] = {0};
+	unsigned long modeCount[8] = {0};
+	unsigned long sourceCount[16] = {0};
+	unsigned long awakeCount[16] = {0};
+	double sleepCharge = 0.0;
+	double awakeTime = 0.0;
+	double elapsed = 0.0;
+	uint16_t vccLow = 0xFFFF;
+	uint16_t vccHigh = 0;
+	uint16_t vccLast = 0;
+
+	if (listing) {
+	    printf("%6s %4s  %-20s %12s %12s  %-10s %6s\n",
+	           "Record", "Seq", "Mode", "Asleep ms", "Awake ms", "Woken by", "VCC");
+	}
+
+	for (size_t i = 0; i < timeline.size(); i++) {
+	    const traceRecord_t &r = timeline[i];
+	    uint8_t mode = traceMode(r);
+	    double asleep = bucketUnits(traceDuration(r)) * tickMicros;
+	    double awake = bucketUnits(traceAwake(r)) * tickMicros;
+	    uint16_t vcc = traceDecodeVcc(r.vcc);
+
+	    modeTime[mode] += asleep;
+	    modeCount[mode]++;
+	    sourceCount[traceSource(r)]++;
+	    awakeCount[traceAwake(r)]++;
+	    sleepCharge += asleep * modeMicroamps(mode);
+	    awakeTime += awake;
+	    elapsed += awake + asleep;
+
+	    if (vcc) {
+	        vccLow = vcc < vccLow ? vcc : vccLow;
+	        vccHigh = vcc > vccHigh ? vcc : vccHigh;
+	        vccLast = vcc;
+	    }
+
+	    if (listing) {
+	        printf("%6zu %4u  %-20s %12.1f %12.1f  %-10s %6u\n",
+	               i, r.seq, modeName(mode), asleep / 1000.0, awake / 1000.0,
+	               sourceName(traceSource(r)), vcc);
+	    }
+	}
+
+	if (listing) {
+	    printf("\n");
+	}
+
+	//---------------------------------------------------------
+	// Report.
+	//---------------------------------------------------------
+	printf("Records:     %zu\n", timeline.size());
+	printf("Elapsed:     %.1f s, %.1f%% awake\n",
+	       elapsed / 1e6, elapsed > 0 ? 100.0 * awakeTime / elapsed : 0.0);
+
+	printf("\nResidency by sleep mode:\n");
+	printf("  %-20s %8s %12s %8s %10s\n", "Mode", "Sleeps", "Seconds", "Time", "uA");
+	for (uint8_t mode = 0; mode < 8; mode++) {
+	    if (!modeCount[mode]) {
+	        continue;
+	    }
+
+	    printf("  %-20s %8lu %12.1f %7.1f%% %10u\n",
+	           modeName(mode), modeCount[mode], modeTime[mode] / 1e6,
+	           elapsed > 0 ? 100.0 * modeTime[mode] / elapsed : 0.0,
+	           (unsigned)modeMicroamps(mode));
+	}
+	printf("  %-20s %8s %12.1f %7.1f%% %10.0f\n",
+	       "Awake", "", awakeTime / 1e6,
+	       elapsed > 0 ? 100.0 * awakeTime / elapsed : 0.0, activeMicros);
+
+	printf("\nWake up sources:\n");
+	for (uint8_t source = 0; source < 16; source++) {
+	    if (!sourceCount[source]) {
+	        continue;
+	    }
+
+	    printf("  %-20s %8lu %7.1f%%\n", sourceName(source), sourceCount[source],
+	           100.0 * sourceCount[source] / timeline.size());
+	}
+
+	printf("\nAwake bursts before each sleep:\n");
+	for (uint8_t bucket = 0; bucket < 16; bucket++) {
+	    if (!awakeCount[bucket]) {
+	        continue;
+	    }
+
+	    if (bucket == 15) {
+	        printf("  %10.1f ms and over ", traceBucketLow(bucket) * tickMicros / 1000.0);
+	    } else if (bucket) {
+	        printf("  %10.1f - %-10.1f ms ", traceBucketLow(bucket) * tickMicros / 1000.0,
+	               (traceBucketHigh(bucket) + 1) * tickMicros / 1000.0);
+	    } else {
+	        printf("  %10s - %-10.1f ms ", "0", tickMicros / 1000.0);
+	    }
+
+	    printf("%8lu %7.1f%%\n", awakeCount[bucket],
+	           100.0 * awakeCount[bucket] / timeline.size());
+	}
+
+	if (vccHigh) {
+	    printf("\nSupply:      %u to %u mV, %u mV last\n", vccLow, vccHigh, vccLast);
+	}
+
+	//---------------------------------------------------------
+	// 1 mAh is 1,000 uA for 3,600,000,000 us.
+	//---------------------------------------------------------
+	double charge = sleepCharge + awakeTime * activeMicros;
+	printf("\nEstimated charge used: %.4f mAh\n", charge / 3.6e12);
+	if (elapsed > 0) {
+	    printf("Average current:       %.1f uA\n", charge / elapsed);
+	    printf("Per day at this rate:  %.3f mAh\n", charge / elapsed * 24.0 / 1000.0);
+	}
+
+	return 0;
+}
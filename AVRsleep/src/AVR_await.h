@@ -0,0 +1,60 @@
+#ifndef AVR_AWAIT_H
+#define AVR_AWAIT_H
+
+/*============================================================
+ * Functions to wait for a peripheral to finish something
+ * while asleep, rather than in a busy wait loop. Each one
+ * enables the peripheral's "done" interrupt and sleeps, in
+ * idle or ADC noise reduction mode, until it arrives. The
+ * wait condition is checked with interrupts disabled, so the
+ * interrupt can't slip in between the check and the sleep.
+ *
+ * These functions own the ADC_vect, EE_READY_vect and the
+ * SPI_STC_vect interrupt handlers. Each handler is in its own
+ * source file, with the functions that need it, so it is only
+ * linked in if one of them is used. A sketch that only uses
+ * awaitSPI(), say, can still have its own ADC_vect.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// ADC. The ADC must be enabled, with its channel and
+	// reference set up. The Arduino's analogRead() does that,
+	// or do it yourself. By default, awaitADC() waits in noise
+	// reduction mode, which stops Timer 0 and millis(). Pass
+	// false to wait in idle instead.
+	//---------------------------------------------------------
+	void startADC();
+	bool adcReady();
+	uint16_t awaitADC(const bool noiseReduction = true);
+
+	//---------------------------------------------------------
+	// EEPROM. Waits for a write to finish.
+	//---------------------------------------------------------
+	void awaitEEPROM();
+
+	//---------------------------------------------------------
+	// Called from the EEPROM ready interrupt handler, for the
+	// EEPROM write queue. Return true to keep the interrupt on.
+	//---------------------------------------------------------
+	typedef bool (*eepromReadyFN)();
+	void attachEEPROMReady(const eepromReadyFN erfn);
+
+	//---------------------------------------------------------
+	// USART. Waits for transmission to finish.
+	//---------------------------------------------------------
+	inline void awaitUSART() { AVRsleep.drainUSART(); }
+
+	//---------------------------------------------------------
+	// SPI. Send a byte, as master, and return the byte that
+	// came back.
+	//---------------------------------------------------------
+	uint8_t awaitSPI(const uint8_t data);
+
+} // End of namespace.
+
+#endif // AVR_AWAIT_H
@@ -0,0 +1,78 @@
+#include "AVR_await.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Set by the interrupt handler.
+	//-------------------------------------------------------------
+	static volatile bool adcDone = true;
+
+	//-------------------------------------------------------------
+	// Start an ADC conversion with its interrupt enabled. Use
+	// adcReady() to see if it has finished, or awaitADC() to
+	// sleep until it has and get the result.
+	//-------------------------------------------------------------
+	void startADC() {
+		adcDone = false;
+		ADCSRA |= (1 << ADSC) | (1 << ADIE);
+	}
+
+	//-------------------------------------------------------------
+	// Has the last conversion finished?
+	//-------------------------------------------------------------
+	bool adcReady() {
+		return adcDone;
+	}
+
+	//-------------------------------------------------------------
+	// Convert, asleep, and return the result. If a conversion has
+	// already been started, we wait for that one.
+	//
+	// Noise reduction mode stops the CPU and I/O clocks, so the
+	// result is better than a busy wait's, as well as cheaper.
+	// But the I/O clock runs the USART and Timer 0 too, so we
+	// let the USART finish sending first, or the frame on the
+	// wire would be stretched and garbled, and Timer 0 stands
+	// still while we sleep, which millis() never gets back.
+	// Pass false to sleep in idle instead, which keeps them both
+	// running, when that matters more than the noise.
+	//
+	// Other interrupts will wake us, but we go back to sleep until
+	// the conversion is done.
+	//-------------------------------------------------------------
+	uint16_t awaitADC(const bool noiseReduction) {
+		if (!(ADCSRA & (1 << ADEN))) {
+		    return 0;
+		}
+
+		sleepMode_t mode = SM_IDLE;
+
+		if (noiseReduction) {
+		    AVRsleep.drainUSART();
+		    mode = SM_ADC;
+		}
+
+		if (adcDone) {
+		    startADC();
+		}
+
+		uint8_t oldSREG = SREG;
+		cli();
+		while (!adcDone) {
+		    AVRsleep.nap(mode);
+		}
+		SREG = oldSREG;
+
+		return ADC;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// ADC conversion complete.
+//-------------------------------------------------------------
+ISR(ADC_vect) {
+	AVRsleep.recordWake(sleep::WAKE_ADC);
+	ADCSRA &= ~(1 << ADIE);
+	sleep::adcDone = true;
+}
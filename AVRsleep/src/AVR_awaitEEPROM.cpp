@@ -0,0 +1,51 @@
+#include "AVR_await.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Called by the EEPROM ready interrupt handler.
+	//-------------------------------------------------------------
+	static eepromReadyFN eepromReady = nullptr;
+
+	//-------------------------------------------------------------
+	// Wait for an EEPROM write to finish. The EEPROM ready
+	// interrupt is a level, not an edge, so the handler turns
+	// itself off.
+	//-------------------------------------------------------------
+	void awaitEEPROM() {
+		uint8_t oldSREG = SREG;
+		cli();
+
+		while (EECR & (1 << EEPE)) {
+		    EECR |= (1 << EERIE);
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Attach a function to the EEPROM ready interrupt. This is
+	// how the EEPROM write queue gets to start the next write.
+	//-------------------------------------------------------------
+	void attachEEPROMReady(const eepromReadyFN erfn) {
+		uint8_t oldSREG = SREG;
+		cli();
+		eepromReady = erfn;
+		SREG = oldSREG;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// EEPROM ready. Turn ourselves off or we'll keep firing, unless
+// the attached function has started another write.
+//-------------------------------------------------------------
+ISR(EE_READY_vect) {
+	AVRsleep.recordWake(sleep::WAKE_EEPROM);
+	if (sleep::eepromReady && (sleep::eepromReady)()) {
+	    return;
+	}
+
+	EECR &= ~(1 << EERIE);
+}
@@ -0,0 +1,60 @@
+#include "AVR_await.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Set by the interrupt handler.
+	//-------------------------------------------------------------
+	static volatile bool spiDone = true;
+	static volatile uint8_t spiData = 0;
+
+	//-------------------------------------------------------------
+	// Send a byte over SPI, as master, and return the byte that
+	// came back. A byte takes 8 SPI clocks, and at the faster SPI
+	// clock rates that's over before we could get to sleep and
+	// wake up again, so for those we just wait. For the slower
+	// rates, the SPI interrupt wakes us from idle.
+	//-------------------------------------------------------------
+	uint8_t awaitSPI(const uint8_t data) {
+
+		//---------------------------------------------------------
+		// SPR1:0 give F_CPU/4, /16, /64 or /128. SPI2X doubles it.
+		// Anything faster than F_CPU/32 isn't worth sleeping for.
+		//---------------------------------------------------------
+		bool fast = (SPCR & 0x03) < 2;
+
+		if (fast) {
+		    SPDR = data;
+		    while (!(SPSR & (1 << SPIF))) {
+		        ;
+		    }
+		    return SPDR;
+		}
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		spiDone = false;
+		SPCR |= (1 << SPIE);
+		SPDR = data;
+
+		while (!spiDone) {
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+
+		SREG = oldSREG;
+		return spiData;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// SPI transfer complete. SPIF is cleared by the hardware as
+// we get here.
+//-------------------------------------------------------------
+ISR(SPI_STC_vect) {
+	AVRsleep.recordWake(sleep::WAKE_SPI);
+	SPCR &= ~(1 << SPIE);
+	sleep::spiData = SPDR;
+	sleep::spiDone = true;
+}
@@ -0,0 +1,209 @@
+#include "AVR_console.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_console::AVR_console() :
+		rd(nullptr),
+		lf(nullptr),
+		timeout(0),
+		tickPeriod(sleep::TICK_16MS),
+		timer0(false),
+		stopping(false),
+		sessionPRR(0),
+		lineTicks(0),
+		preamble(0),
+		preambleState(0),
+		line(),
+		length(0)
+		{}
+
+	//-------------------------------------------------------------
+	// Set up the session.
+	//-------------------------------------------------------------
+	void AVR_console::begin(
+		    const readFN rfn,
+		    const consoleLineFN clfn,
+		    const uint16_t timeoutPeriods,
+		    const tickPeriod_t period,
+		    const bool keepTimer0) {
+
+		rd = rfn;
+		lf = clfn;
+		timeout = timeoutPeriods;
+		tickPeriod = period;
+		timer0 = keepTimer0;
+	}
+
+	//-------------------------------------------------------------
+	// Collect a byte into the line. CR or LF ends a line, empty
+	// lines are ignored. Backspace and DEL remove the last byte.
+	// Anything that won't fit is dropped.
+	//
+	// If there is a preamble, then at the start of a session
+	// everything up to, and including, the first run of preamble
+	// bytes is thrown away. That gets rid of a first byte that
+	// was garbled or lost while the board was waking up.
+	//-------------------------------------------------------------
+	void AVR_console::receive(const char c) {
+		if (preambleState) {
+		    if (c == preamble) {
+		        preambleState = 2;
+		        return;
+		    }
+
+		    if (preambleState == 1) {
+		        return;
+		    }
+
+		    preambleState = 0;
+		}
+
+		if (c == '\r' || c == '\n') {
+		    if (length) {
+		        line[length] = '\0';
+		        length = 0;
+		        if (lf) {
+		            uint8_t gatedPRR = PRR;
+		            uint16_t started = AVRtick.ticks();
+		            AVRsleep.writePRR(sessionPRR);
+		            (lf)(line);
+		            AVRsleep.writePRR(gatedPRR);
+		            lineTicks += (uint16_t)(AVRtick.ticks() - started);
+		        }
+		    }
+		    return;
+		}
+
+		if (c == '\b' || c == 0x7f) {
+		    if (length) {
+		        length--;
+		    }
+		    return;
+		}
+
+		if (length < AVR_CONSOLE_LINE_SIZE - 1) {
+		    line[length++] = c;
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Run a session. Everything except the USART, and Timer 0 if
+	// requested, is powered off via the PRR, as far as AVRsleep
+	// allows: anything kept powered, locked or busy is left on.
+	// We sleep in idle waiting for the receive interrupt. Each
+	// byte restarts the inactivity timeout, which is counted in
+	// WDT periods. When it runs out, or end() is called, the PRR
+	// is put back. It is also put back while the line function
+	// runs, so that the command can use whatever was powered
+	// before the session.
+	//
+	// If Timer 0 was running and we stopped it, millis() is moved
+	// on by the time it was stopped, to the nearest WDT period.
+	//
+	// The read function is called with interrupts disabled, so
+	// that a byte arriving between it and the sleep will still
+	// wake us.
+	//-------------------------------------------------------------
+	void AVR_console::run() {
+		if (!rd) {
+		    return;
+		}
+
+		sessionPRR = PRR;
+		uint8_t keep = (1 << PRUSART0) | (timer0 ? (1 << PRTIM0) : 0);
+		uint8_t gate = AVRsleep.allowedPRR(sleep::PM_PRR_OFF & ~keep);
+		AVRsleep.writePRR(gate);
+
+		bool started = !AVRtick.running();
+		if (started) {
+		    AVRtick.begin(tickPeriod);
+		}
+
+		//---------------------------------------------------------
+		// If AVRtick was already running, for someone else, it may
+		// be at another period, so the timeout is converted into
+		// its periods, rounding up.
+		//---------------------------------------------------------
+		tickPeriod_t running = AVRtick.period();
+		uint32_t limit = timeout;
+		if (running < tickPeriod) {
+		    limit <<= tickPeriod - running;
+		} else if (running > tickPeriod) {
+		    uint8_t shift = running - tickPeriod;
+		    limit = (limit + (1UL << shift) - 1) >> shift;
+		}
+
+		stopping = false;
+		length = 0;
+		preambleState = preamble ? 1 : 0;
+		lineTicks = 0;
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		//---------------------------------------------------------
+		// The tick count is only 16 bits, so the time idle, and
+		// the length of the session, are added up as we go.
+		//---------------------------------------------------------
+		uint16_t seen = AVRtick.ticks();
+		uint32_t idle = 0;
+		uint32_t total = 0;
+
+		while (!stopping) {
+		    int c = (rd)();
+		    if (c >= 0) {
+		        sei();
+		        receive(char(c));
+		        cli();
+		    }
+
+		    uint16_t now = AVRtick.ticks();
+		    uint16_t passed = now - seen;
+		    seen = now;
+		    total += passed;
+
+		    if (c >= 0) {
+		        idle = 0;
+		        continue;
+		    }
+
+		    idle += passed;
+
+		    if (idle >= limit) {
+		        break;
+		    }
+
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+
+		SREG = oldSREG;
+
+		if (started) {
+		    AVRtick.end();
+		}
+
+		AVRsleep.writePRR(sessionPRR);
+
+		//---------------------------------------------------------
+		// In chunks, as 8 S periods soon overflow 32 bits of uS.
+		//---------------------------------------------------------
+		if ((gate & ~sessionPRR) & (1 << PRTIM0)) {
+		    uint32_t stopped = total > lineTicks ? total - lineTicks : 0;
+		    while (stopped) {
+		        uint8_t chunk = stopped > 255 ? 255 : stopped;
+		        AVRsleep.creditMillis(chunk * (16000UL << running));
+		        stopped -= chunk;
+		    }
+		}
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_console object.
+//-------------------------------------------------------------
+sleep::AVR_console AVRconsole;
+
@@ -0,0 +1,139 @@
+#ifndef AVR_CONSOLE_H
+#define AVR_CONSOLE_H
+
+/*============================================================
+ * The AVR_console class runs a serial command session with
+ * the board asleep in idle between received bytes. Only the
+ * USART, and optionally Timer 0, are powered. Bytes are
+ * collected into a line buffer and each complete line is
+ * passed to the sketch. When nothing has been received for
+ * a while, the session ends and the sketch can go back into
+ * power down.
+ *
+ * The USART's receive interrupt must be enabled, which it is
+ * by Serial.begin(), as that is what wakes the board. The
+ * inactivity timeout uses AVR_tick, so the same restrictions
+ * on interrupt handlers apply.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_tick.h"
+
+//-------------------------------------------------------------
+// The longest line, including the terminating zero byte.
+//-------------------------------------------------------------
+#ifndef AVR_CONSOLE_LINE_SIZE
+#define AVR_CONSOLE_LINE_SIZE 32
+#endif
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Fetch the next received byte, or -1 if there isn't one.
+	// This is called with interrupts disabled.
+	//---------------------------------------------------------
+	typedef int (*readFN)();
+
+	//---------------------------------------------------------
+	// Called with each complete line, without the line end.
+	//---------------------------------------------------------
+	typedef void (*consoleLineFN)(char *line);
+
+
+	class AVR_console {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_console();
+
+		//---------------------------------------------------------
+		// Where bytes come from, where lines go, and how long
+		// to wait, in WDT periods, before ending a session.
+		//---------------------------------------------------------
+		void begin(
+		        const readFN rfn,
+		        const consoleLineFN clfn,
+		        const uint16_t timeoutPeriods,
+		        const tickPeriod_t period = sleep::TICK_16MS,
+		        const bool keepTimer0 = false);
+
+		//---------------------------------------------------------
+		// Run a session until it times out or end() is called.
+		//---------------------------------------------------------
+		void run();
+
+		//---------------------------------------------------------
+		// End the session early, from the line function.
+		//---------------------------------------------------------
+		void end() { stopping = true; }
+
+		//---------------------------------------------------------
+		// Bytes to throw away at the start of a session. Zero to
+		// keep everything.
+		//---------------------------------------------------------
+		void setPreamble(const char c) { preamble = c; }
+
+	private:
+		//---------------------------------------------------------
+		// Add a byte to the line, passing it on when complete.
+		//---------------------------------------------------------
+		void receive(const char c);
+
+		//---------------------------------------------------------
+		// Where bytes come from, and lines go to.
+		//---------------------------------------------------------
+		readFN rd;
+		consoleLineFN lf;
+
+		//---------------------------------------------------------
+		// Inactivity timeout.
+		//---------------------------------------------------------
+		uint16_t timeout;
+		tickPeriod_t tickPeriod;
+
+		//---------------------------------------------------------
+		// Leave Timer 0 powered? (For millis() etc.)
+		//---------------------------------------------------------
+		bool timer0;
+
+		//---------------------------------------------------------
+		// Set by end().
+		//---------------------------------------------------------
+		bool stopping;
+
+		//---------------------------------------------------------
+		// The PRR before the session, restored afterwards and
+		// while the line function runs.
+		//---------------------------------------------------------
+		uint8_t sessionPRR;
+
+		//---------------------------------------------------------
+		// WDT periods spent in the line function, when Timer 0
+		// was running again.
+		//---------------------------------------------------------
+		uint32_t lineTicks;
+
+		//---------------------------------------------------------
+		// The preamble byte, and where we are with it.
+		//---------------------------------------------------------
+		char preamble;
+		uint8_t preambleState;
+
+		//---------------------------------------------------------
+		// The line so far.
+		//---------------------------------------------------------
+		char line[AVR_CONSOLE_LINE_SIZE];
+		uint8_t length;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_console AVRconsole;
+
+#endif // AVR_CONSOLE_H
@@ -0,0 +1,48 @@
+#ifndef AVR_CRC_H
+#define AVR_CRC_H
+
+/*============================================================
+ * CRC-16/CCITT-FALSE: polynomial 0x1021, starting at 0xFFFF,
+ * not reflected, no final XOR. Used to check data that has to
+ * survive a reset, or be read back by a host tool.
+ *
+ * This header has no AVR dependencies, so the host tools in
+ * extras/tools use it too, and get the same answers.
+ *===========================================================*/
+
+#include <stdint.h>
+#include <stddef.h>
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Add one byte to a CRC.
+	//---------------------------------------------------------
+	inline uint16_t crc16Update(uint16_t crc, const uint8_t data) {
+		crc ^= (uint16_t)data << 8;
+
+		for (uint8_t bit = 0; bit < 8; bit++) {
+		    crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+		}
+
+		return crc;
+	}
+
+	//---------------------------------------------------------
+	// CRC a block. Pass the previous result as the last
+	// argument to carry on from an earlier block.
+	//---------------------------------------------------------
+	inline uint16_t crc16(const void *data, size_t length, uint16_t crc = 0xFFFF) {
+		const uint8_t *bytes = (const uint8_t *)data;
+
+		while (length--) {
+		    crc = crc16Update(crc, *bytes++);
+		}
+
+		return crc;
+	}
+
+} // End of namespace.
+
+#endif // AVR_CRC_H
@@ -0,0 +1,188 @@
+#include "AVR_debounce.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// The pin change function. Runs in the interrupt handler.
+	//-------------------------------------------------------------
+	static void pinBounced(const uint8_t pcint, const bool level) {
+		(void)level;
+		AVRdebounce.bounced(pcint);
+	}
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_debounce::AVR_debounce() :
+		db(nullptr),
+		settle(2),
+		pins(),
+		stable(),
+		changedPins()
+		{}
+
+	//-------------------------------------------------------------
+	// Where to report to and how long to settle for. At least one
+	// WDT period is needed.
+	//-------------------------------------------------------------
+	void AVR_debounce::begin(const debounceFN dbfn, const uint8_t settlePeriods) {
+		db = dbfn;
+		settle = settlePeriods ? settlePeriods : 1;
+	}
+
+	//-------------------------------------------------------------
+	// Start debouncing a pin. Its current level is the starting
+	// stable level.
+	//-------------------------------------------------------------
+	void AVR_debounce::add(const uint8_t pcint) {
+		if (pcint > 23) {
+		    return;
+		}
+
+		uint8_t group = pcint >> 3;
+		uint8_t bit = (1 << (pcint & 0x07));
+
+		pins[group] |= bit;
+		if (AVRpcint.level(pcint)) {
+		    stable[group] |= bit;
+		} else {
+		    stable[group] &= ~bit;
+		}
+
+		AVRpcint.attach(pcint, pinBounced);
+	}
+
+	//-------------------------------------------------------------
+	// Stop debouncing a pin.
+	//-------------------------------------------------------------
+	void AVR_debounce::remove(const uint8_t pcint) {
+		if (pcint > 23) {
+		    return;
+		}
+
+		AVRpcint.detach(pcint);
+
+		uint8_t group = pcint >> 3;
+		uint8_t bit = (1 << (pcint & 0x07));
+
+		pins[group] &= ~bit;
+
+		uint8_t oldSREG = SREG;
+		cli();
+		changedPins[group] &= ~bit;
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// A pin has changed. Mask it, so that the rest of its bounces
+	// don't wake us up, and leave it for update(). This is also
+	// called by update() itself, hence the interrupt juggling.
+	//-------------------------------------------------------------
+	void AVR_debounce::bounced(const uint8_t pcint) {
+		AVRpcint.disable(pcint);
+
+		uint8_t oldSREG = SREG;
+		cli();
+		changedPins[pcint >> 3] |= (1 << (pcint & 0x07));
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Anything to do?
+	//-------------------------------------------------------------
+	bool AVR_debounce::pending() const {
+		return changedPins[0] | changedPins[1] | changedPins[2];
+	}
+
+	//-------------------------------------------------------------
+	// Debounce any pins that changed. We sleep in power down for
+	// the settling time, then sample the pins once per WDT period
+	// until two samples in a row agree. If they never agree, the
+	// last sample is used. Any pin that now differs from its last
+	// reported level is reported, and all the changed pins are
+	// unmasked again.
+	//
+	// Returns the number of changes reported.
+	//-------------------------------------------------------------
+	uint8_t AVR_debounce::update() {
+		if (!pending()) {
+		    return 0;
+		}
+
+		//---------------------------------------------------------
+		// Take the changed pins. Any more changes, on other pins,
+		// during the settling time will be picked up next time.
+		//---------------------------------------------------------
+		uint8_t work[3];
+		uint8_t oldSREG = SREG;
+		cli();
+		for (uint8_t group = 0; group < 3; group++) {
+		    work[group] = changedPins[group];
+		    changedPins[group] = 0;
+		}
+		SREG = oldSREG;
+
+		AVRtick.sleep(settle);
+
+		uint8_t sample[3];
+		for (uint8_t group = 0; group < 3; group++) {
+		    sample[group] = *AVRpcint.pinRegister(group << 3);
+		}
+
+		for (uint8_t tries = settle; tries; tries--) {
+		    AVRtick.sleep(1);
+
+		    uint8_t moving = 0;
+		    for (uint8_t group = 0; group < 3; group++) {
+		        uint8_t now = *AVRpcint.pinRegister(group << 3);
+		        moving |= (now ^ sample[group]) & work[group];
+		        sample[group] = now;
+		    }
+
+		    if (!moving) {
+		        break;
+		    }
+		}
+
+		//---------------------------------------------------------
+		// Report and unmask. If a pin moves again between being
+		// sampled and being unmasked, we would miss it, so check
+		// again once it is listening.
+		//---------------------------------------------------------
+		uint8_t reported = 0;
+		for (uint8_t group = 0; group < 3; group++) {
+		    uint8_t bits = work[group] & pins[group];
+		    for (uint8_t bit = 0; bits; bit++, bits >>= 1) {
+		        if (!(bits & 0x01)) {
+		            continue;
+		        }
+
+		        uint8_t pcint = (group << 3) + bit;
+		        uint8_t mask = (1 << bit);
+		        bool high = sample[group] & mask;
+
+		        if (high != bool(stable[group] & mask)) {
+		            stable[group] ^= mask;
+		            reported++;
+		            if (db) {
+		                (db)(pcint, high);
+		            }
+		        }
+
+		        AVRpcint.enable(pcint);
+		        if (AVRpcint.level(pcint) != high) {
+		            bounced(pcint);
+		        }
+		    }
+		}
+
+		return reported;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_debounce object.
+//-------------------------------------------------------------
+sleep::AVR_debounce AVRdebounce;
+
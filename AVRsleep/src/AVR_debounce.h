@@ -0,0 +1,102 @@
+#ifndef AVR_DEBOUNCE_H
+#define AVR_DEBOUNCE_H
+
+/*============================================================
+ * The AVR_debounce class debounces switches and buttons while
+ * asleep. A pin change wakes the board, the pin is masked so
+ * that the bounces don't keep waking it, then the board goes
+ * back to sleep in power down for a few WDT periods before
+ * the pin is sampled again. Only a clean change of level is
+ * reported.
+ *
+ * Debouncing takes place at power down current, not at the
+ * full running current of a busy wait.
+ *
+ * Uses AVR_pcint and AVR_tick, so the same restrictions on
+ * interrupt handlers apply.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_pcint.h"
+#include "AVR_tick.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Called, from update(), when a pin has a new, debounced,
+	// level.
+	//---------------------------------------------------------
+	typedef void (*debounceFN)(const uint8_t pcint, const bool level);
+
+
+	class AVR_debounce {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_debounce();
+
+		//---------------------------------------------------------
+		// Where to report changes, and how many 16 mS WDT periods
+		// to let the pins settle for.
+		//---------------------------------------------------------
+		void begin(const debounceFN dbfn, const uint8_t settlePeriods = 2);
+
+		//---------------------------------------------------------
+		// Add/remove a pin. The pin must already be an INPUT.
+		//---------------------------------------------------------
+		void add(const uint8_t pcint);
+		void remove(const uint8_t pcint);
+
+		//---------------------------------------------------------
+		// Has a pin changed since the last update()?
+		//---------------------------------------------------------
+		bool pending() const;
+
+		//---------------------------------------------------------
+		// Debounce any changed pins. Call after waking.
+		//---------------------------------------------------------
+		uint8_t update();
+
+		//---------------------------------------------------------
+		// The debounced level of a pin.
+		//---------------------------------------------------------
+		bool level(const uint8_t pcint) const {
+		    return stable[pcint >> 3] & (1 << (pcint & 0x07));
+		}
+
+		//---------------------------------------------------------
+		// Called, from the pin change interrupt handler, only.
+		//---------------------------------------------------------
+		void bounced(const uint8_t pcint);
+
+	private:
+		//---------------------------------------------------------
+		// Function to call with debounced changes.
+		//---------------------------------------------------------
+		debounceFN db;
+
+		//---------------------------------------------------------
+		// How many WDT periods to settle for.
+		//---------------------------------------------------------
+		uint8_t settle;
+
+		//---------------------------------------------------------
+		// Pins being debounced, their last reported levels, and
+		// those that have changed since update(), per port.
+		//---------------------------------------------------------
+		uint8_t pins[3];
+		uint8_t stable[3];
+		volatile uint8_t changedPins[3];
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_debounce AVRdebounce;
+
+#endif // AVR_DEBOUNCE_H
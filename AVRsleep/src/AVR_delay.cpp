@@ -0,0 +1,169 @@
+#include "AVR_delay.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#else
+#include <util/delay_basic.h>
+#endif
+
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// The measured length of the shortest WDT period, in uS. Zero
+	// until it has been measured. The longer periods are exactly
+	// 2, 4, ... 512 times as long, as they come from the same
+	// oscillator.
+	//-------------------------------------------------------------
+	static uint32_t tickMicros = 0;
+
+	//-------------------------------------------------------------
+	// Without Timer 0 we can't measure the WDT, so use the data
+	// sheet's figure: 2,048 cycles of 128 KHz.
+	//-------------------------------------------------------------
+	void calibrateDelay() {
+	#ifdef ARDUINO
+		if (AVRtick.running()) {
+		    return;
+		}
+
+		AVRtick.begin(sleep::TICK_16MS);
+		uint32_t start = micros();
+
+		uint8_t oldSREG = SREG;
+		cli();
+		while (!AVRtick.ticks()) {
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+		SREG = oldSREG;
+
+		tickMicros = micros() - start;
+		AVRtick.end();
+	#else
+		tickMicros = 16000;
+	#endif
+	}
+
+	//-------------------------------------------------------------
+	// Wait in idle, with everything that goToSleep() would power
+	// off turned off except Timer 0, whose overflow interrupt
+	// wakes us every 1,024 uS to check the time. The USART is left
+	// alone if it's still sending. The last millisecond or so is
+	// a busy wait, so that we don't overshoot by a whole Timer 0
+	// period.
+	//
+	// Without Timer 0 running, there's nothing to wake us, so it's
+	// all a busy wait.
+	//-------------------------------------------------------------
+	static void idleWait(uint32_t us) {
+	#ifdef ARDUINO
+		uint8_t off = AVRsleep.sleepPRR() & ~(1 << PRTIM0);
+		if ((UCSR0B & (1 << UDRIE0)) || !(UCSR0A & (1 << UDRE0))) {
+		    off &= ~(1 << PRUSART0);
+		}
+
+		uint8_t oldPRR = PRR;
+		AVRsleep.writePRR(oldPRR | off);
+
+		uint32_t start = micros();
+
+		uint8_t oldSREG = SREG;
+		cli();
+		while (micros() - start + 1100 < us) {
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+		SREG = oldSREG;
+
+		while (micros() - start < us) {
+		    ;
+		}
+
+		AVRsleep.writePRR(oldPRR);
+	#else
+		//---------------------------------------------------------
+		// _delay_loop_2() takes 4 cycles per count.
+		//---------------------------------------------------------
+		for (; us >= 1000; us -= 1000) {
+		    _delay_loop_2(F_CPU / 4000);
+		}
+
+		if (us) {
+		    _delay_loop_2((uint16_t)(us * (F_CPU / 1000000UL) / 4) + 1);
+		}
+	#endif
+	}
+
+	//-------------------------------------------------------------
+	// Sleep for a number of microseconds. As much as possible is
+	// spent in power down, using the longest WDT periods that fit,
+	// and the rest in idle.
+	//
+	// Timer 0 is stopped in power down, so nothing can tell how
+	// long it really took, and the idle part can't make up for
+	// any error. Instead, the WDT is measured again at the start
+	// of every delay long enough to use it, as part of the delay,
+	// so the error is only what the WDT drifts during the delay.
+	//
+	// If the WDT is already ticking for someone else, or a
+	// transaction lock is held, it is all spent in idle.
+	//-------------------------------------------------------------
+	static void sleepMicros(uint32_t remaining) {
+
+		bool deep = !AVRtick.running() &&
+		            !AVRsleep.isLocked() &&
+		            !AVRsleep.busyPeripherals();
+
+		if (deep && remaining > 4 * 16000UL) {
+		    calibrateDelay();
+	#ifdef ARDUINO
+		    remaining -= (tickMicros < remaining) ? tickMicros : remaining;
+	#endif
+		}
+
+		if (deep && tickMicros) {
+		    uint32_t slept = 0;
+
+		    if (remaining >= tickMicros) {
+		        AVRsleep.drainUSART();
+		    }
+
+		    for (int8_t period = sleep::TICK_8S; period >= sleep::TICK_16MS; period--) {
+		        uint32_t periodMicros = tickMicros << period;
+
+		        while (remaining >= periodMicros) {
+		            uint32_t count = remaining / periodMicros;
+		            if (count > 255) {
+		                count = 255;
+		            }
+
+		            AVRtick.sleep(count, (tickPeriod_t)period);
+		            remaining -= count * periodMicros;
+		            slept += count * periodMicros;
+		        }
+		    }
+
+		    AVRsleep.creditMillis(slept);
+		}
+
+		idleWait(remaining);
+	}
+
+	//-------------------------------------------------------------
+	// Sleep for a number of milliseconds. More than about 71
+	// minutes of microseconds won't fit in 32 bits, so a long
+	// delay is taken an hour at a time.
+	//-------------------------------------------------------------
+	void lowPowerDelay(const uint32_t ms) {
+		const uint32_t hour = 3600000UL;
+		uint32_t left = ms;
+
+		while (left > hour) {
+		    sleepMicros(hour * 1000UL);
+		    left -= hour;
+		}
+
+		sleepMicros(left * 1000UL);
+	}
+
+} // End of namespace.
+
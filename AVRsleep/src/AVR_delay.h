@@ -0,0 +1,37 @@
+#ifndef AVR_DELAY_H
+#define AVR_DELAY_H
+
+/*============================================================
+ * A replacement for delay() and _delay_ms() that sleeps
+ * instead of spinning. Long delays are mostly spent in power
+ * down, woken by the WDT, and the rest, along with short
+ * delays, is spent in idle with only Timer 0 running.
+ *
+ * The WDT's oscillator is not accurate, so it is measured
+ * against Timer 0 at the start of each delay that needs it.
+ * On the Arduino, millis() and micros() are moved on by the
+ * time spent in power down, when Timer 0 is stopped.
+ *
+ * Uses AVR_tick, so the same restrictions on interrupt
+ * handlers apply.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_tick.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Sleep for a number of milliseconds.
+	//---------------------------------------------------------
+	void lowPowerDelay(const uint32_t ms);
+
+	//---------------------------------------------------------
+	// Measure the WDT period again. Takes about 16 mS.
+	//---------------------------------------------------------
+	void calibrateDelay();
+
+} // End of namespace.
+
+#endif // AVR_DELAY_H
@@ -0,0 +1,145 @@
+#include "AVR_eeQueue.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// The EEPROM ready function. Runs in the interrupt handler.
+	//-------------------------------------------------------------
+	static bool eepromReady() {
+		return AVReeQueue.ready();
+	}
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_eeQueue::AVR_eeQueue() :
+		jobs(),
+		head(0),
+		count(0),
+		submitted(0),
+		completed(0)
+		{}
+
+	//-------------------------------------------------------------
+	// Queue a write. If the queue is full, we sleep in idle until
+	// there is room. If the queue was empty, we take a lock and
+	// enable the EEPROM ready interrupt, which will fire as soon
+	// as the EEPROM is free, and get things going.
+	//
+	// Returns a ticket. Tickets wrap around, so don't hang on to
+	// one for more than 127 writes.
+	//-------------------------------------------------------------
+	uint8_t AVR_eeQueue::submit(
+		    const uint16_t address,
+		    const void *data,
+		    const uint8_t length) {
+
+		attachEEPROMReady(eepromReady);
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		while (count == AVR_EEQUEUE_JOBS) {
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+
+		eeJob_t &job = jobs[(head + count) % AVR_EEQUEUE_JOBS];
+		job.address = address;
+		job.data = (const uint8_t *)data;
+		job.length = length;
+
+		if (!count++) {
+		    AVRsleep.lock();
+		    EECR |= (1 << EERIE);
+		}
+
+		uint8_t ticket = ++submitted;
+		if (!ticket) {
+		    ticket = ++submitted;
+		}
+
+		SREG = oldSREG;
+		return ticket;
+	}
+
+	//-------------------------------------------------------------
+	// Tickets are handed out, and completed, in order.
+	//-------------------------------------------------------------
+	bool AVR_eeQueue::isComplete(const uint8_t ticket) const {
+		uint8_t done = completed;
+
+		if (!ticket) {
+		    return !count;
+		}
+
+		//---------------------------------------------------------
+		// Ticket zero is never issued, so the completed count
+		// skips it too.
+		//---------------------------------------------------------
+		return (int8_t)(done - ticket) >= 0;
+	}
+
+	//-------------------------------------------------------------
+	// Sleep in idle until a write, or all of them, are done.
+	//-------------------------------------------------------------
+	void AVR_eeQueue::wait(const uint8_t ticket) {
+		uint8_t oldSREG = SREG;
+		cli();
+
+		while (!isComplete(ticket)) {
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// The EEPROM is free. Read the next byte to be written, and
+	// if it differs, start writing it and return true to keep the
+	// interrupt on. Bytes that are already correct are skipped.
+	// When the queue is empty, release the lock and return false
+	// to turn the interrupt off.
+	//
+	// EEMPE must be set, then EEPE within 4 cycles. We are in an
+	// interrupt handler, so nothing will get in the way.
+	//-------------------------------------------------------------
+	bool AVR_eeQueue::ready() {
+		if (!count) {
+		    return false;
+		}
+
+		while (count) {
+		    eeJob_t &job = jobs[head];
+
+		    while (job.length) {
+		        uint8_t value = *job.data++;
+		        EEAR = job.address++;
+		        job.length--;
+
+		        EECR |= (1 << EERE);
+		        if (EEDR != value) {
+		            EEDR = value;
+		            EECR = (1 << EEMPE) | (1 << EERIE);
+		            EECR |= (1 << EEPE);
+		            return true;
+		        }
+		    }
+
+		    head = (head + 1) % AVR_EEQUEUE_JOBS;
+		    count--;
+		    if (!++completed) {
+		        ++completed;
+		    }
+		}
+
+		AVRsleep.unlock();
+		return false;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_eeQueue object.
+//-------------------------------------------------------------
+sleep::AVR_eeQueue AVReeQueue;
+
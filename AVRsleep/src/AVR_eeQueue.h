@@ -0,0 +1,97 @@
+#ifndef AVR_EEQUEUE_H
+#define AVR_EEQUEUE_H
+
+/*============================================================
+ * The AVR_eeQueue class writes blocks of data to the EEPROM
+ * in the background, one byte per EEPROM ready interrupt, so
+ * that the board can sleep in idle for the 3.4 mS each byte
+ * takes rather than spinning. Bytes that already hold the
+ * right value are not written at all, which saves time and
+ * EEPROM wear.
+ *
+ * While the queue is busy, it holds an AVRsleep lock, so
+ * goToSleep() will only go into idle. The EEPROM ready
+ * interrupt can't wake the board from anything deeper.
+ *
+ * Uses the EEPROM ready interrupt handler in AVR_await.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_await.h"
+
+//-------------------------------------------------------------
+// How many writes can be queued.
+//-------------------------------------------------------------
+#ifndef AVR_EEQUEUE_JOBS
+#define AVR_EEQUEUE_JOBS 4
+#endif
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// One queued write.
+	//---------------------------------------------------------
+	typedef struct eeJob {
+	    uint16_t address;
+	    const uint8_t *data;
+	    uint8_t length;
+	} eeJob_t;
+
+
+	class AVR_eeQueue {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_eeQueue();
+
+		//---------------------------------------------------------
+		// Queue a write. Returns a ticket for isComplete() and
+		// wait(). The data must not change until it's written.
+		//---------------------------------------------------------
+		uint8_t submit(
+		        const uint16_t address,
+		        const void *data,
+		        const uint8_t length);
+
+		//---------------------------------------------------------
+		// Has a write, or all of them, finished?
+		//---------------------------------------------------------
+		bool isComplete(const uint8_t ticket) const;
+		bool busy() const { return count != 0; }
+
+		//---------------------------------------------------------
+		// Sleep until a write, or all of them, have finished.
+		//---------------------------------------------------------
+		void wait(const uint8_t ticket = 0);
+
+		//---------------------------------------------------------
+		// Called from the EEPROM ready interrupt handler only.
+		//---------------------------------------------------------
+		bool ready();
+
+	private:
+		//---------------------------------------------------------
+		// The queue.
+		//---------------------------------------------------------
+		eeJob_t jobs[AVR_EEQUEUE_JOBS];
+		uint8_t head;
+		volatile uint8_t count;
+
+		//---------------------------------------------------------
+		// Tickets issued, and completed.
+		//---------------------------------------------------------
+		uint8_t submitted;
+		volatile uint8_t completed;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_eeQueue AVReeQueue;
+
+#endif // AVR_EEQUEUE_H
@@ -0,0 +1,97 @@
+#ifndef AVR_ENERGY_H
+#define AVR_ENERGY_H
+
+/*============================================================
+ * Typical supply currents for a bare ATmega328P at 5V, 16 MHz
+ * and 25C, in microamps, worked out from the data sheet's
+ * typical characteristics. They are estimates: a real board's
+ * regulator, LEDs and USB chip can draw far more than the AVR
+ * itself, so measure your own board if you can, and scale.
+ *
+ * These are functions rather than tables, so that nothing is
+ * copied into the AVR's RAM. This header has no AVR
+ * dependencies, so the host tools in extras/tools use it too.
+ *===========================================================*/
+
+#include <stdint.h>
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Running flat out, with every peripheral powered.
+	//---------------------------------------------------------
+	inline uint32_t activeMicroamps() {
+		return 9500;
+	}
+
+	//---------------------------------------------------------
+	// By sleep mode, as the SMCR bits SM2:0. Power down and
+	// power save include the WDT running, which is how the
+	// library usually wakes from them. The standby modes keep
+	// the crystal oscillator running.
+	//---------------------------------------------------------
+	inline uint32_t modeMicroamps(const uint8_t smBits) {
+		switch (smBits & 0x07) {
+		    case 0: return 2700;                // Idle
+		    case 1: return 1000;                // ADC noise reduction
+		    case 2: return 7;                   // Power down
+		    case 3: return 8;                   // Power save
+		    case 6: return 200;                 // Standby
+		    case 7: return 210;                 // Extended standby
+		    default: return 0;                  // Reserved
+		}
+	}
+
+	//---------------------------------------------------------
+	// The extra current each peripheral draws when powered, in
+	// active and idle modes, by PRR bit number.
+	//---------------------------------------------------------
+	inline uint32_t peripheralMicroamps(const uint8_t prrBit) {
+		switch (prrBit) {
+		    case 0: return 950;                 // ADC
+		    case 1: return 310;                 // USART
+		    case 2: return 500;                 // SPI
+		    case 3: return 430;                 // Timer 1
+		    case 5: return 140;                 // Timer 0
+		    case 6: return 540;                 // Timer 2
+		    case 7: return 700;                 // TWI
+		    default: return 0;
+		}
+	}
+
+	//---------------------------------------------------------
+	// Awake, with only the peripherals whose bits are set here
+	// powered. The CPU, flash and the rest draw whatever's left
+	// of activeMicroamps() once all the peripherals are off.
+	//---------------------------------------------------------
+	inline uint32_t awakeMicroamps(const uint8_t poweredPRR) {
+		uint32_t current = activeMicroamps();
+
+		for (uint8_t bit = 0; bit < 8; bit++) {
+		    if (!(poweredPRR & (1 << bit))) {
+		        current -= peripheralMicroamps(bit);
+		    }
+		}
+
+		return current;
+	}
+
+	//---------------------------------------------------------
+	// The sleep mode names, by SMCR bits SM2:0.
+	//---------------------------------------------------------
+	inline const char *modeName(const uint8_t smBits) {
+		switch (smBits & 0x07) {
+		    case 0: return "Idle";
+		    case 1: return "ADC noise reduction";
+		    case 2: return "Power down";
+		    case 3: return "Power save";
+		    case 6: return "Standby";
+		    case 7: return "Extended standby";
+		    default: return "Reserved";
+		}
+	}
+
+} // End of namespace.
+
+#endif // AVR_ENERGY_H
@@ -0,0 +1,125 @@
+#ifndef AVR_EVENTQUEUE_H
+#define AVR_EVENTQUEUE_H
+
+/*============================================================
+ * A queue of small event records from interrupt handlers to
+ * the main loop. There must be one producer, usually a single
+ * interrupt handler, and one consumer, usually loop(). Neither
+ * side needs to disable interrupts: the head and tail indices
+ * are single bytes, which the AVR reads and writes in one go,
+ * and each is only ever written by one side.
+ *
+ * The capacity must be a power of two, up to 128. The indices
+ * run freely from 0 to 255 and are masked to get the slot, so
+ * a full queue and an empty one look different.
+ *
+ * waitForEvent() sleeps, through AVRsleep.goToSleep(), until
+ * there is something in the queue. The queue is checked with
+ * interrupts disabled right before the sleep instruction, so
+ * an event can't be missed.
+ *
+ * As this is a template, it all lives in this header.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+
+
+namespace sleep {
+
+	template <typename T, uint8_t SIZE = 8>
+	class AVR_eventQueue {
+
+		static_assert(SIZE && SIZE <= 128 && !(SIZE & (SIZE - 1)),
+		              "AVR_eventQueue: SIZE must be a power of two, up to 128.");
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_eventQueue() :
+			head(0),
+			tail(0),
+			dropped(0)
+			{}
+
+		//---------------------------------------------------------
+		// Producer. Add an event, returning false if the queue
+		// is full. The event is copied in before the tail is
+		// moved on, so the consumer never sees half of one.
+		//---------------------------------------------------------
+		bool push(const T &event) {
+			uint8_t t = tail;
+
+			if ((uint8_t)(t - head) == SIZE) {
+			    dropped++;
+			    return false;
+			}
+
+			events[t & (SIZE - 1)] = event;
+			__asm__ __volatile__ ("" ::: "memory");
+			tail = t + 1;
+			return true;
+		}
+
+		//---------------------------------------------------------
+		// Consumer. Take the next event, returning false if the
+		// queue is empty. The event isn't read until the tail has
+		// been, so it can't be a stale copy, and it's copied out
+		// before the head is moved on, so the producer can't
+		// overwrite it.
+		//---------------------------------------------------------
+		bool pop(T &event) {
+			uint8_t h = head;
+
+			if (h == tail) {
+			    return false;
+			}
+
+			__asm__ __volatile__ ("" ::: "memory");
+			event = events[h & (SIZE - 1)];
+			__asm__ __volatile__ ("" ::: "memory");
+			head = h + 1;
+			return true;
+		}
+
+		//---------------------------------------------------------
+		// Consumer. Sleep until there's an event, then take it.
+		//---------------------------------------------------------
+		T waitForEvent() {
+			T event;
+
+			while (!pop(event)) {
+			    AVRsleep.goToSleep(hasEvents, this);
+			}
+
+			return event;
+		}
+
+		//---------------------------------------------------------
+		// How many events are waiting? How many have been lost
+		// because the queue was full?
+		//---------------------------------------------------------
+		bool empty() const { return head == tail; }
+		uint8_t size() const { return (uint8_t)(tail - head); }
+		uint8_t overflows() const { return dropped; }
+
+	private:
+		//---------------------------------------------------------
+		// The test for goToSleep().
+		//---------------------------------------------------------
+		static bool hasEvents(const void *context) {
+			return !((const AVR_eventQueue *)context)->empty();
+		}
+
+		//---------------------------------------------------------
+		// The queue.
+		//---------------------------------------------------------
+		T events[SIZE];
+		volatile uint8_t head;
+		volatile uint8_t tail;
+		volatile uint8_t dropped;
+	};
+
+} // End of namespace.
+
+#endif // AVR_EVENTQUEUE_H
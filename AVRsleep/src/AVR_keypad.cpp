@@ -0,0 +1,243 @@
+#include "AVR_keypad.h"
+
+#include <util/delay_basic.h>
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// The pin change function. Runs in the interrupt handler.
+	//-------------------------------------------------------------
+	static void columnChanged(const uint8_t pcint, const bool level) {
+		(void)pcint;
+		(void)level;
+		AVRkeypad.keyWake();
+	}
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_keypad::AVR_keypad() :
+		rows(),
+		cols(),
+		nRows(0),
+		nCols(0),
+		kf(nullptr),
+		scanPeriods(1),
+		scanMode(sleep::SM_POWER_DOWN),
+		scanLimit(8),
+		keys(),
+		woken(false)
+		{}
+
+	//-------------------------------------------------------------
+	// Record the pins and park the keypad, ready to sleep.
+	//-------------------------------------------------------------
+	void AVR_keypad::begin(
+		    const uint8_t *rowPins, const uint8_t rowCount,
+		    const uint8_t *colPins, const uint8_t colCount,
+		    const keyFN kfn) {
+
+		nRows = (rowCount > 8) ? 8 : rowCount;
+		nCols = (colCount > 8) ? 8 : colCount;
+
+		for (uint8_t x = 0; x < nRows; x++) {
+		    rows[x] = rowPins[x];
+		    keys[x] = 0;
+		}
+
+		for (uint8_t x = 0; x < nCols; x++) {
+		    cols[x] = colPins[x];
+		}
+
+		kf = kfn;
+		park();
+	}
+
+	//-------------------------------------------------------------
+	// How many WDT periods to sleep between scans, and in which
+	// mode. Each period is about 16 mS and this also acts as the
+	// debounce time. After "limit" scans with a key still held,
+	// update() gives up and parks the keypad.
+	//-------------------------------------------------------------
+	void AVR_keypad::setScanRate(
+		    const uint8_t periods,
+		    const sleepMode_t sleepMode,
+		    const uint8_t limit) {
+		scanPeriods = periods ? periods : 1;
+		scanMode = sleepMode;
+		scanLimit = limit ? limit : 1;
+	}
+
+	//-------------------------------------------------------------
+	// Drive a row low.
+	//-------------------------------------------------------------
+	void AVR_keypad::rowLow(const uint8_t row) {
+		uint8_t bit = (1 << (rows[row] & 0x07));
+		*AVRpcint.portRegister(rows[row]) &= ~bit;
+		*AVRpcint.ddrRegister(rows[row]) |= bit;
+	}
+
+	//-------------------------------------------------------------
+	// Let a row float, no pullup.
+	//-------------------------------------------------------------
+	void AVR_keypad::rowFloat(const uint8_t row) {
+		uint8_t bit = (1 << (rows[row] & 0x07));
+		*AVRpcint.ddrRegister(rows[row]) &= ~bit;
+		*AVRpcint.portRegister(rows[row]) &= ~bit;
+	}
+
+	//-------------------------------------------------------------
+	// All rows low, columns INPUT_PULLUP with a pin change
+	// interrupt. Pressing any key will pull a column low and wake
+	// us up. If keys are still held, their columns are already
+	// low, so releasing them wakes us instead.
+	//-------------------------------------------------------------
+	void AVR_keypad::park() {
+		woken = false;
+
+		uint8_t heldCols = 0;
+		for (uint8_t x = 0; x < nRows; x++) {
+		    heldCols |= keys[x];
+		}
+
+		for (uint8_t x = 0; x < nRows; x++) {
+		    rowLow(x);
+		}
+
+		for (uint8_t x = 0; x < nCols; x++) {
+		    uint8_t bit = (1 << (cols[x] & 0x07));
+		    *AVRpcint.ddrRegister(cols[x]) &= ~bit;
+		    *AVRpcint.portRegister(cols[x]) |= bit;
+		    AVRpcint.attach(cols[x], columnChanged);
+		}
+
+		//---------------------------------------------------------
+		// If a key went down, or a held one came up, while we were
+		// setting up, we missed its interrupt.
+		//---------------------------------------------------------
+		for (uint8_t x = 0; x < nCols; x++) {
+		    bool low = !AVRpcint.level(cols[x]);
+		    bool held = heldCols & (1 << x);
+		    if (low != held) {
+		        keyWake();
+		    }
+		}
+	}
+
+	//-------------------------------------------------------------
+	// A column changed. Stop listening, update() will scan.
+	//-------------------------------------------------------------
+	void AVR_keypad::keyWake() {
+		for (uint8_t x = 0; x < nCols; x++) {
+		    AVRpcint.disable(cols[x]);
+		}
+
+		woken = true;
+	}
+
+	//-------------------------------------------------------------
+	// Drive one row low at a time, the rest floating, and read
+	// the columns. A low column is a pressed key. Changes since
+	// the last scan are reported.
+	//-------------------------------------------------------------
+	bool AVR_keypad::scan() {
+		bool anyDown = false;
+
+		for (uint8_t x = 0; x < nRows; x++) {
+		    rowFloat(x);
+		}
+
+		for (uint8_t row = 0; row < nRows; row++) {
+		    rowLow(row);
+
+		    // A pressed key pulls its column down hard, but the
+		    // pin synchroniser needs a cycle to see it.
+		    __asm__ __volatile__ ("nop");
+
+		    uint8_t now = 0;
+		    for (uint8_t col = 0; col < nCols; col++) {
+		        if (!AVRpcint.level(cols[col])) {
+		            now |= (1 << col);
+		        }
+		    }
+
+		    rowFloat(row);
+
+		    //-----------------------------------------------------
+		    // A pressed key on this row was holding its column
+		    // low. Only the pullup brings it back up, against the
+		    // pin and wiring capacitance, so give it about 5 uS
+		    // before the next row is read, or the key will show
+		    // up on that row too. _delay_loop_1() takes 3 cycles
+		    // per count.
+		    //-----------------------------------------------------
+		    _delay_loop_1((uint8_t)(F_CPU / 600000UL) + 1);
+
+		    uint8_t diff = now ^ keys[row];
+		    keys[row] = now;
+		    anyDown |= (now != 0);
+
+		    for (uint8_t col = 0; diff && kf; col++, diff >>= 1) {
+		        if (diff & 0x01) {
+		            (kf)(row * nCols + col, now & (1 << col));
+		        }
+		    }
+		}
+
+		return anyDown;
+	}
+
+	//-------------------------------------------------------------
+	// If a key woke us up, scan the keypad, sleeping between
+	// scans, until every key has been released, or the scan limit
+	// is reached. Then park the keypad so that the sketch can go
+	// into power down. If a key is still held, releasing it, or
+	// pressing a key in another column, will wake us again.
+	//
+	// Returns the number of scans made.
+	//-------------------------------------------------------------
+	uint8_t AVR_keypad::update() {
+		if (!woken) {
+		    return 0;
+		}
+
+		uint8_t scans = 0;
+		while (true) {
+		    bool held = scan();
+		    scans++;
+
+		    if (!held || scans >= scanLimit) {
+		        break;
+		    }
+
+		    AVRtick.sleep(scanPeriods, sleep::TICK_16MS, scanMode);
+		}
+
+		park();
+		return scans;
+	}
+
+	//-------------------------------------------------------------
+	// Is a key down?
+	//-------------------------------------------------------------
+	bool AVR_keypad::isPressed(const uint8_t key) const {
+		if (!nCols) {
+		    return false;
+		}
+
+		uint8_t row = key / nCols;
+		uint8_t col = key % nCols;
+		if (row >= nRows) {
+		    return false;
+		}
+
+		return keys[row] & (1 << col);
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_keypad object.
+//-------------------------------------------------------------
+sleep::AVR_keypad AVRkeypad;
+
@@ -0,0 +1,135 @@
+#ifndef AVR_KEYPAD_H
+#define AVR_KEYPAD_H
+
+/*============================================================
+ * The AVR_keypad class scans a matrix keypad without keeping
+ * the board awake waiting for a key. While idle, the keypad
+ * is parked with all rows driven low and the columns pulled
+ * up, with a pin change interrupt on each column, so any key
+ * wakes the board from power down. While a key is held, the
+ * board sleeps between scans. When everything is released,
+ * or a key has been held for too many scans, the keypad is
+ * parked again.
+ *
+ * Uses AVR_pcint and AVR_tick, so the same restrictions on
+ * interrupt handlers apply.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_pcint.h"
+#include "AVR_tick.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Called, from update(), when a key is pressed or released.
+	// Keys are numbered row * columns + column.
+	//---------------------------------------------------------
+	typedef void (*keyFN)(const uint8_t key, const bool pressed);
+
+
+	class AVR_keypad {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_keypad();
+
+		//---------------------------------------------------------
+		// The row and column pins, as PCINT numbers, up to 8 of
+		// each, and where to report keys to. Parks the keypad.
+		//---------------------------------------------------------
+		void begin(
+		        const uint8_t *rowPins, const uint8_t rowCount,
+		        const uint8_t *colPins, const uint8_t colCount,
+		        const keyFN kfn);
+
+		//---------------------------------------------------------
+		// How to sleep between scans while a key is held, and how
+		// many scans to make before parking with it still held.
+		//---------------------------------------------------------
+		void setScanRate(
+		        const uint8_t periods,
+		        const sleepMode_t sleepMode = sleep::SM_POWER_DOWN,
+		        const uint8_t limit = 8);
+
+		//---------------------------------------------------------
+		// Has a key woken us?
+		//---------------------------------------------------------
+		bool pending() const { return woken; }
+
+		//---------------------------------------------------------
+		// Scan until all keys are released, or the scan limit is
+		// reached. Call after waking.
+		//---------------------------------------------------------
+		uint8_t update();
+
+		//---------------------------------------------------------
+		// Is a key down, as of the last scan?
+		//---------------------------------------------------------
+		bool isPressed(const uint8_t key) const;
+
+		//---------------------------------------------------------
+		// Called, from the pin change interrupt handler, only.
+		//---------------------------------------------------------
+		void keyWake();
+
+	private:
+		//---------------------------------------------------------
+		// All rows low, columns pulled up and listening.
+		//---------------------------------------------------------
+		void park();
+
+		//---------------------------------------------------------
+		// Scan once, report changes. Returns true if any key is
+		// down.
+		//---------------------------------------------------------
+		bool scan();
+
+		//---------------------------------------------------------
+		// Drive a row low, or let it float.
+		//---------------------------------------------------------
+		void rowLow(const uint8_t row);
+		void rowFloat(const uint8_t row);
+
+		//---------------------------------------------------------
+		// Pins, as PCINT numbers.
+		//---------------------------------------------------------
+		uint8_t rows[8];
+		uint8_t cols[8];
+		uint8_t nRows;
+		uint8_t nCols;
+
+		//---------------------------------------------------------
+		// Where to report to.
+		//---------------------------------------------------------
+		keyFN kf;
+
+		//---------------------------------------------------------
+		// Sleep between scans.
+		//---------------------------------------------------------
+		uint8_t scanPeriods;
+		sleepMode_t scanMode;
+		uint8_t scanLimit;
+
+		//---------------------------------------------------------
+		// One bit per column, one byte per row. Set = pressed.
+		//---------------------------------------------------------
+		uint8_t keys[8];
+
+		//---------------------------------------------------------
+		// Set by the pin change interrupt.
+		//---------------------------------------------------------
+		volatile bool woken;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_keypad AVRkeypad;
+
+#endif // AVR_KEYPAD_H
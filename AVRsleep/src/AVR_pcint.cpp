@@ -0,0 +1,170 @@
+#include "AVR_pcint.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Constructor. Nulls out the function pointers.
+	//-------------------------------------------------------------
+	AVR_pcint::AVR_pcint() :
+		handlers(),
+		lastPins()
+		{}
+
+	//-------------------------------------------------------------
+	// PCINT0-7 are on port B, PCINT8-14 on port C and PCINT16-23
+	// on port D.
+	//-------------------------------------------------------------
+	volatile uint8_t *AVR_pcint::pinRegister(const uint8_t pcint) {
+		switch (pcint >> 3) {
+		    case 0: return &PINB;
+		    case 1: return &PINC;
+		    default: return &PIND;
+		}
+	}
+
+	volatile uint8_t *AVR_pcint::ddrRegister(const uint8_t pcint) {
+		switch (pcint >> 3) {
+		    case 0: return &DDRB;
+		    case 1: return &DDRC;
+		    default: return &DDRD;
+		}
+	}
+
+	volatile uint8_t *AVR_pcint::portRegister(const uint8_t pcint) {
+		switch (pcint >> 3) {
+		    case 0: return &PORTB;
+		    case 1: return &PORTC;
+		    default: return &PORTD;
+		}
+	}
+
+	volatile uint8_t *AVR_pcint::maskRegister(const uint8_t pcint) {
+		switch (pcint >> 3) {
+		    case 0: return &PCMSK0;
+		    case 1: return &PCMSK1;
+		    default: return &PCMSK2;
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Attach a function to a pin and start listening to it.
+	//-------------------------------------------------------------
+	void AVR_pcint::attach(const uint8_t pcint, const pinChangeFN pcfn) {
+		if (pcint > 23) {
+		    return;
+		}
+
+		uint8_t oldSREG = SREG;
+		cli();
+		handlers[pcint] = pcfn;
+		SREG = oldSREG;
+
+		enable(pcint);
+	}
+
+	//-------------------------------------------------------------
+	// Stop listening to a pin, and forget its function.
+	//-------------------------------------------------------------
+	void AVR_pcint::detach(const uint8_t pcint) {
+		if (pcint > 23) {
+		    return;
+		}
+
+		disable(pcint);
+
+		uint8_t oldSREG = SREG;
+		cli();
+		handlers[pcint] = nullptr;
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Unmask a pin. The pin's current level is recorded so that
+	// a change made while it was masked is not reported as a new
+	// one.
+	//-------------------------------------------------------------
+	void AVR_pcint::enable(const uint8_t pcint) {
+		if (pcint > 23) {
+		    return;
+		}
+
+		uint8_t group = pcint >> 3;
+		uint8_t bit = (1 << (pcint & 0x07));
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		lastPins[group] = (lastPins[group] & ~bit) |
+		                  (*pinRegister(pcint) & bit);
+		*maskRegister(pcint) |= bit;
+		PCICR |= (1 << group);
+
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Mask a pin. The port's interrupt is turned off when the
+	// last pin on it goes.
+	//-------------------------------------------------------------
+	void AVR_pcint::disable(const uint8_t pcint) {
+		if (pcint > 23) {
+		    return;
+		}
+
+		uint8_t group = pcint >> 3;
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		volatile uint8_t *mask = maskRegister(pcint);
+		*mask &= ~(1 << (pcint & 0x07));
+		if (!*mask) {
+		    PCICR &= ~(1 << group);
+		}
+
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// One or more pins on a port has changed. Work out which, and
+	// call their functions.
+	//-------------------------------------------------------------
+	void AVR_pcint::changed(const uint8_t group) {
+		uint8_t pins = *pinRegister(group << 3);
+		uint8_t diff = (pins ^ lastPins[group]) & *maskRegister(group << 3);
+		lastPins[group] = pins;
+
+		for (uint8_t pcint = (group << 3); diff; pcint++, diff >>= 1) {
+		    if ((diff & 0x01) && handlers[pcint]) {
+		        (handlers[pcint])(pcint, pins & 0x01);
+		    }
+
+		    pins >>= 1;
+		}
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// The interrupt handlers, one per port.
+//-------------------------------------------------------------
+ISR(PCINT0_vect) {
+	AVRsleep.recordWake(sleep::WAKE_PCINT0);
+	AVRpcint.changed(0);
+}
+
+ISR(PCINT1_vect) {
+	AVRsleep.recordWake(sleep::WAKE_PCINT1);
+	AVRpcint.changed(1);
+}
+
+ISR(PCINT2_vect) {
+	AVRsleep.recordWake(sleep::WAKE_PCINT2);
+	AVRpcint.changed(2);
+}
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_pcint object.
+//-------------------------------------------------------------
+sleep::AVR_pcint AVRpcint;
+
@@ -0,0 +1,105 @@
+#ifndef AVR_PCINT_H
+#define AVR_PCINT_H
+
+/*============================================================
+ * The AVR_pcint class shares out the three pin change
+ * interrupts between the parts of the AVR_sleep library, and
+ * sketches, that need to be woken by a pin. Pin changes will
+ * wake the board from every sleep mode.
+ *
+ * Pins are identified by their PCINT number, as in the data
+ * sheet:
+ *
+ *  PCINT0  - PCINT7  are PB0 - PB7 (D8 - D13).
+ *  PCINT8  - PCINT14 are PC0 - PC6 (A0 - A5, RESET).
+ *  PCINT16 - PCINT23 are PD0 - PD7 (D0 - D7).
+ *
+ * This class owns the PCINT0_vect, PCINT1_vect and PCINT2_vect
+ * interrupt handlers, so it can not be used in the same sketch
+ * as SoftwareSerial or other libraries that need them.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Called, from the interrupt handler, when a pin changes.
+	//---------------------------------------------------------
+	typedef void (*pinChangeFN)(const uint8_t pcint, const bool level);
+
+
+	class AVR_pcint {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_pcint();
+
+		//---------------------------------------------------------
+		// Attach/detach a function to a pin. Attaching enables
+		// the pin change interrupt on that pin.
+		//---------------------------------------------------------
+		void attach(const uint8_t pcint, const pinChangeFN pcfn);
+		void detach(const uint8_t pcint);
+
+		//---------------------------------------------------------
+		// The function attached to a pin, if any.
+		//---------------------------------------------------------
+		pinChangeFN attached(const uint8_t pcint) const {
+		    return (pcint > 23) ? nullptr : handlers[pcint];
+		}
+
+		//---------------------------------------------------------
+		// Mask/unmask a pin without losing its function.
+		//---------------------------------------------------------
+		void enable(const uint8_t pcint);
+		void disable(const uint8_t pcint);
+
+		//---------------------------------------------------------
+		// Called from the interrupt handlers only.
+		//---------------------------------------------------------
+		void changed(const uint8_t group);
+
+		//---------------------------------------------------------
+		// The PINx, DDRx and PORTx registers for a pin.
+		//---------------------------------------------------------
+		static volatile uint8_t *pinRegister(const uint8_t pcint);
+		static volatile uint8_t *ddrRegister(const uint8_t pcint);
+		static volatile uint8_t *portRegister(const uint8_t pcint);
+
+		//---------------------------------------------------------
+		// Read a pin.
+		//---------------------------------------------------------
+		static bool level(const uint8_t pcint) {
+		    return *pinRegister(pcint) & (1 << (pcint & 0x07));
+		}
+
+	private:
+		//---------------------------------------------------------
+		// The PCMSKx register for a pin.
+		//---------------------------------------------------------
+		static volatile uint8_t *maskRegister(const uint8_t pcint);
+
+		//---------------------------------------------------------
+		// One function per pin. PCINT15 doesn't exist, but it
+		// makes the indexing simpler.
+		//---------------------------------------------------------
+		pinChangeFN handlers[24];
+
+		//---------------------------------------------------------
+		// The pin levels at the last interrupt, per port.
+		//---------------------------------------------------------
+		uint8_t lastPins[3];
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_pcint AVRpcint;
+
+#endif // AVR_PCINT_H
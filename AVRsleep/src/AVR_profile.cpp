@@ -0,0 +1,360 @@
+#include "AVR_profile.h"
+#include "AVR_traceFormat.h"
+#include <avr/eeprom.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace sleep {
+
+	static const uint16_t PROFILE_MAGIC = 0x5EE9;
+
+	static_assert(sizeof(uint32_t) + sizeof(sleepProfile_t) <= 32,
+	              "AVR_profile: too many tiers for AVR_PROFILE_ADDRESS.");
+
+	static_assert(AVR_PROFILE_ADDRESS >=
+	              TRACE_DEFAULT_RECORDS * sizeof(traceRecord_t),
+	              "AVR_profile: AVR_PROFILE_ADDRESS is inside the default AVR_trace ring.");
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_profile::AVR_profile() :
+		active(),
+		working(),
+		stored(),
+		eeAddress(0),
+		wr(nullptr),
+		batteryTier(0)
+		{}
+
+	//-------------------------------------------------------------
+	// Use the saved profile if its magic number, CRC and settings
+	// are all good, otherwise the defaults. The defaults aren't
+	// saved until a profile is committed.
+	//-------------------------------------------------------------
+	bool AVR_profile::begin(
+		    const sleepProfile_t &defaults,
+		    const writeFN wfn,
+		    const uint16_t address) {
+
+		wr = wfn;
+		eeAddress = address;
+
+		AVReeQueue.wait();
+		eeprom_read_block(&stored, (const void *)eeAddress, sizeof(stored));
+
+		bool loaded = stored.magic == PROFILE_MAGIC &&
+		              stored.crc == crc16(&stored.profile, sizeof(sleepProfile_t)) &&
+		              valid(stored.profile);
+
+		active = loaded ? stored.profile : defaults;
+		working = active;
+		batteryTier = 0;
+		apply();
+
+		return loaded;
+	}
+
+	//-------------------------------------------------------------
+	// The sleep mode must be one the AVR has, the power bits must
+	// all mean something, the WDT must stay on, and the periods
+	// must exist. Tiers must fall in voltage, with the unused ones
+	// last, and a lower battery mustn't mean waking up more often.
+	//-------------------------------------------------------------
+	bool AVR_profile::valid(const sleepProfile_t &candidate) {
+		uint8_t smBits = candidate.sleepMode >> 1;
+
+		if ((candidate.sleepMode & ~0x0E) || smBits == 4 || smBits == 5) {
+		    return false;
+		}
+
+		//---------------------------------------------------------
+		// The WDT is what wakes us every period, so it can't be
+		// turned off. Doing that remotely would leave a board
+		// that never wakes up again.
+		//---------------------------------------------------------
+		if ((candidate.powerBits & ~sleep::PM_EVERYTHING_OFF) ||
+		    (candidate.powerBits & (1 << sleep::PM_WDT_OFF))) {
+		    return false;
+		}
+
+		if (candidate.period > sleep::TICK_8S) {
+		    return false;
+		}
+
+		uint16_t lastMillivolts = 0xFFFF;
+		uint8_t lastPeriod = candidate.period;
+		for (uint8_t t = 0; t < AVR_PROFILE_TIERS; t++) {
+		    uint16_t mv = candidate.tierMillivolts[t];
+
+		    if (!mv) {
+		        lastMillivolts = 0;
+		        continue;
+		    }
+
+		    if (mv >= lastMillivolts ||
+		        candidate.tierPeriods[t] > sleep::TICK_8S ||
+		        candidate.tierPeriods[t] < lastPeriod) {
+		        return false;
+		    }
+
+		    lastMillivolts = mv;
+		    lastPeriod = candidate.tierPeriods[t];
+		}
+
+		return true;
+	}
+
+	//-------------------------------------------------------------
+	// Check a profile, save it, and put it in force. The saved
+	// copy is left alone until the EEPROM has been written, so
+	// we wait for any earlier write first, and this one after.
+	//-------------------------------------------------------------
+	bool AVR_profile::set(const sleepProfile_t &newProfile) {
+		if (!valid(newProfile)) {
+		    return false;
+		}
+
+		AVReeQueue.wait();
+		stored.magic = PROFILE_MAGIC;
+		stored.profile = newProfile;
+		stored.crc = crc16(&stored.profile, sizeof(sleepProfile_t));
+		AVReeQueue.wait(AVReeQueue.submit(eeAddress, &stored, sizeof(stored)));
+
+		active = newProfile;
+		working = newProfile;
+		apply();
+
+		return true;
+	}
+
+	bool AVR_profile::commit() {
+		if (set(working)) {
+		    return true;
+		}
+
+		working = active;
+		return false;
+	}
+
+	//-------------------------------------------------------------
+	// setSleepMode() only records the settings, so they're used
+	// from the next goToSleep() on.
+	//
+	// The WDT period is NOT applied here. AVRtick may be ticking
+	// for someone else, the console session that delivered the
+	// command for one, who counts in its own periods. The sketch
+	// starts AVRtick with period() when it's ready to use it.
+	//-------------------------------------------------------------
+	void AVR_profile::apply() {
+		AVRsleep.setSleepMode((sleepMode_t)active.sleepMode,
+		                      (powerMode_t)active.powerBits);
+
+		if (batteryTier && !active.tierMillivolts[batteryTier - 1]) {
+		    batteryTier = 0;
+		}
+	}
+
+	//-------------------------------------------------------------
+	// The tier is the last one whose voltage we're below.
+	//-------------------------------------------------------------
+	uint8_t AVR_profile::checkBattery(const uint16_t millivolts) {
+		batteryTier = 0;
+
+		for (uint8_t t = 0; t < AVR_PROFILE_TIERS; t++) {
+		    if (active.tierMillivolts[t] && millivolts < active.tierMillivolts[t]) {
+		        batteryTier = t + 1;
+		    }
+		}
+
+		return batteryTier;
+	}
+
+	tickPeriod_t AVR_profile::period() const {
+		return (tickPeriod_t)(batteryTier ?
+		                      active.tierPeriods[batteryTier - 1] :
+		                      active.period);
+	}
+
+	//-------------------------------------------------------------
+	// Commands are a letter and some numbers, several to a line:
+	//
+	//  M n         Sleep mode, as SMCR bits SM2:0.
+	//  P n         Power off bits.
+	//  W n         WDT period, 0 (16 mS) to 9 (8 S).
+	//  S n         Slack, in WDT periods.
+	//  T t mV n    Battery tier t, from 1, and its WDT period.
+	//  !           Check, save and use the changes.
+	//  X           Throw the changes away.
+	//  ?           Send the profile in force.
+	//
+	// Numbers may be decimal, or hex with a leading 0x. Changes
+	// are made to a working copy, so a profile is only checked
+	// as a whole when it's committed. The reply is "OK", or
+	// "ERR" if anything failed.
+	//-------------------------------------------------------------
+	bool AVR_profile::command(char *line) {
+		bool ok = true;
+		char *p = line;
+
+		while (*p) {
+		    char c = *p++;
+		    if (c == ' ' || c == '\t' || c == ',') {
+		        continue;
+		    }
+
+		    uint8_t wanted = 0;
+		    switch (c) {
+		        case 'M': case 'm':
+		        case 'P': case 'p':
+		        case 'W': case 'w':
+		        case 'S': case 's':
+		            wanted = 1;
+		            break;
+
+		        case 'T': case 't':
+		            wanted = 3;
+		            break;
+
+		        case '!':
+		            ok = commit() && ok;
+		            continue;
+
+		        case 'X': case 'x':
+		            working = active;
+		            continue;
+
+		        case '?':
+		            report();
+		            continue;
+
+		        default:
+		            ok = false;
+		            continue;
+		    }
+
+		    //-----------------------------------------------------
+		    // Read the numbers. Anything that isn't one ends the
+		    // line, as we can't tell where the next command is.
+		    //-----------------------------------------------------
+		    uint32_t values[3];
+		    for (uint8_t v = 0; v < wanted; v++) {
+		        char *end;
+		        values[v] = strtoul(p, &end, 0);
+		        if (end == p) {
+		            reply("ERR\r\n");
+		            return false;
+		        }
+		        p = end;
+		    }
+
+		    switch (c | 0x20) {
+		        case 'm':
+		            if (values[0] > 7) {
+		                ok = false;
+		            } else {
+		                working.sleepMode = values[0] << 1;
+		            }
+		            break;
+
+		        case 'p':
+		            if (values[0] > 0xFFFF) {
+		                ok = false;
+		            } else {
+		                working.powerBits = values[0];
+		            }
+		            break;
+
+		        case 'w':
+		            if (values[0] > sleep::TICK_8S) {
+		                ok = false;
+		            } else {
+		                working.period = values[0];
+		            }
+		            break;
+
+		        case 's':
+		            if (values[0] > 0xFF) {
+		                ok = false;
+		            } else {
+		                working.slack = values[0];
+		            }
+		            break;
+
+		        case 't':
+		            if (!values[0] || values[0] > AVR_PROFILE_TIERS ||
+		                values[1] > 0xFFFF || values[2] > sleep::TICK_8S) {
+		                ok = false;
+		            } else {
+		                working.tierMillivolts[values[0] - 1] = values[1];
+		                working.tierPeriods[values[0] - 1] = values[2];
+		            }
+		            break;
+		    }
+		}
+
+		reply(ok ? "OK\r\n" : "ERR\r\n");
+		return ok;
+	}
+
+	//-------------------------------------------------------------
+	// Add a letter and a number to a reply.
+	//-------------------------------------------------------------
+	static char *append(char *to, const char letter, uint16_t value) {
+		char digits[5];
+		uint8_t count = 0;
+
+		if (letter) {
+		    *to++ = letter;
+		}
+
+		do {
+		    digits[count++] = '0' + value % 10;
+		    value /= 10;
+		} while (value);
+
+		while (count) {
+		    *to++ = digits[--count];
+		}
+
+		*to++ = ' ';
+		return to;
+	}
+
+	//-------------------------------------------------------------
+	// The profile in force, as commands that would set it.
+	//-------------------------------------------------------------
+	void AVR_profile::report() {
+		char text[12 + 14 + AVR_PROFILE_TIERS * 14];
+		char *p = text;
+
+		p = append(p, 'M', active.sleepMode >> 1);
+		p = append(p, 'P', active.powerBits);
+		p = append(p, 'W', active.period);
+		p = append(p, 'S', active.slack);
+
+		for (uint8_t t = 0; t < AVR_PROFILE_TIERS; t++) {
+		    p = append(p, 'T', t + 1);
+		    p = append(p, 0, active.tierMillivolts[t]);
+		    p = append(p, 0, active.tierPeriods[t]);
+		}
+
+		p[-1] = '\r';
+		*p++ = '\n';
+		*p = '\0';
+
+		reply(text);
+	}
+
+	void AVR_profile::reply(const char *text) {
+		if (wr) {
+		    (wr)((const uint8_t *)text, strlen(text));
+		}
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_profile object.
+//-------------------------------------------------------------
+sleep::AVR_profile AVRprofile;
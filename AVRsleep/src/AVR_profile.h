@@ -0,0 +1,159 @@
+#ifndef AVR_PROFILE_H
+#define AVR_PROFILE_H
+
+/*============================================================
+ * The AVR_profile class holds a sleep profile: the sleep mode,
+ * the power off bits, the WDT period between wake ups, the
+ * slack the sketch may use to put work off, and battery tiers
+ * that stretch the WDT period as the supply voltage falls.
+ *
+ * The profile is kept in the EEPROM, with a CRC, and can be
+ * changed over the serial port, with short text commands, so
+ * each unit can be tuned where it's installed without being
+ * reflashed. Feed received lines to command(), from AVRconsole
+ * for example. A new profile is checked before it's accepted,
+ * then saved, and set with setSleepMode(), so the next call
+ * to goToSleep() uses it. The WDT period isn't set anywhere:
+ * pass period() to AVRtick.begin() before each sleep.
+ *
+ * Uses AVR_eeQueue, and so the EE_READY_vect interrupt
+ * handler in AVR_await.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_tick.h"
+#include "AVR_eeQueue.h"
+#include "AVR_txBatch.h"
+#include "AVR_crc.h"
+
+//-------------------------------------------------------------
+// How many battery tiers there are.
+//-------------------------------------------------------------
+#ifndef AVR_PROFILE_TIERS
+#define AVR_PROFILE_TIERS 3
+#endif
+
+//-------------------------------------------------------------
+// Where the profile lives in the EEPROM, by default. This is
+// the last 32 bytes, just past the default AVR_trace ring.
+//-------------------------------------------------------------
+#ifndef AVR_PROFILE_ADDRESS
+#define AVR_PROFILE_ADDRESS (E2END + 1 - 32)
+#endif
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// A sleep profile. Below tierMillivolts[n], the WDT period
+	// is tierPeriods[n]. Tiers run from the highest voltage
+	// down, and unused tiers are zero.
+	//---------------------------------------------------------
+	typedef struct sleepProfile {
+	    uint8_t sleepMode;                  // sleepMode_t
+	    uint8_t period;                     // tickPeriod_t
+	    uint16_t powerBits;                 // powerMode_t
+	    uint8_t slack;                      // In WDT periods
+	    uint8_t tierPeriods[AVR_PROFILE_TIERS];
+	    uint16_t tierMillivolts[AVR_PROFILE_TIERS];
+	} sleepProfile_t;
+
+
+	class AVR_profile {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_profile();
+
+		//---------------------------------------------------------
+		// Load the saved profile, or use the defaults if there
+		// isn't a good one, and set it. Replies to commands go
+		// to the write function. Returns true if the saved
+		// profile was loaded.
+		//---------------------------------------------------------
+		bool begin(const sleepProfile_t &defaults,
+		           const writeFN wfn = nullptr,
+		           const uint16_t address = AVR_PROFILE_ADDRESS);
+
+		//---------------------------------------------------------
+		// Carry out a line of commands. Returns false if any of
+		// them failed.
+		//---------------------------------------------------------
+		bool command(char *line);
+
+		//---------------------------------------------------------
+		// Check, save and set a whole profile at once.
+		//---------------------------------------------------------
+		bool set(const sleepProfile_t &newProfile);
+
+		//---------------------------------------------------------
+		// Is a profile any good?
+		//---------------------------------------------------------
+		static bool valid(const sleepProfile_t &candidate);
+
+		//---------------------------------------------------------
+		// Choose the battery tier for this supply voltage.
+		// Returns the tier, where 0 is above all of them.
+		//---------------------------------------------------------
+		uint8_t checkBattery(const uint16_t millivolts);
+
+		//---------------------------------------------------------
+		// The profile in force, and its settings.
+		//---------------------------------------------------------
+		const sleepProfile_t &profile() const { return active; }
+		tickPeriod_t period() const;
+		uint8_t slack() const { return active.slack; }
+		uint8_t tier() const { return batteryTier; }
+
+	private:
+		//---------------------------------------------------------
+		// Set the profile in force with setSleepMode().
+		//---------------------------------------------------------
+		void apply();
+
+		//---------------------------------------------------------
+		// Check, save and set the working copy.
+		//---------------------------------------------------------
+		bool commit();
+
+		//---------------------------------------------------------
+		// Send the profile, as commands, to the write function.
+		//---------------------------------------------------------
+		void report();
+		void reply(const char *text);
+
+		//---------------------------------------------------------
+		// The profile in force, and the copy being edited by
+		// commands, which replaces it when it's committed.
+		//---------------------------------------------------------
+		sleepProfile_t active;
+		sleepProfile_t working;
+
+		//---------------------------------------------------------
+		// The EEPROM copy, which must be left alone while it's
+		// being written, and where it goes.
+		//---------------------------------------------------------
+		struct {
+		    uint16_t magic;
+		    uint16_t crc;
+		    sleepProfile_t profile;
+		} stored;
+		uint16_t eeAddress;
+
+		//---------------------------------------------------------
+		// Where replies go, and the battery tier in force.
+		//---------------------------------------------------------
+		writeFN wr;
+		uint8_t batteryTier;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_profile AVRprofile;
+
+#endif // AVR_PROFILE_H
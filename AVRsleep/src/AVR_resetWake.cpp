@@ -0,0 +1,123 @@
+#include "AVR_resetWake.h"
+#include <string.h>
+#include <stddef.h>
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Written just before a planned reset, and cleared on boot.
+	//-------------------------------------------------------------
+	static const uint16_t RESETWAKE_MAGIC = 0xA5E1;
+
+	//-------------------------------------------------------------
+	// These live in .noinit, so the C runtime leaves them alone.
+	// bootMCUSR has to be there too, as .bss is zeroed after
+	// .init3 has run.
+	//-------------------------------------------------------------
+	static resetWakeBlock_t block __attribute__((section(".noinit")));
+	static uint8_t bootMCUSR __attribute__((section(".noinit")));
+	static bool bootloaderCleared __attribute__((section(".noinit")));
+
+	//-------------------------------------------------------------
+	// The CRC covers everything after the magic number and CRC.
+	//-------------------------------------------------------------
+	static uint16_t blockCRC() {
+		return crc16(&block.wakes,
+		             sizeof(resetWakeBlock_t) - offsetof(resetWakeBlock_t, wakes));
+	}
+
+	//-------------------------------------------------------------
+	// Runs in .init3, before .data is copied or .bss is cleared,
+	// so it must be naked and must not call any functions, which
+	// is fine as wdt_disable() is inline assembler. The WDT is
+	// left running, at 16 mS, after a WDT reset, so turn it off
+	// before it resets us again.
+	//
+	// Optiboot, the Uno's bootloader, clears MCUSR before starting
+	// the sketch, and passes it on in r2 instead. Nothing before
+	// .init3 uses r2, so if MCUSR is zero we take r2. Other
+	// bootloaders may leave anything at all in r2, so it's only
+	// used for resetCause(), not to decide if we've resumed.
+	//-------------------------------------------------------------
+	void resetWakeEarly() __attribute__((naked, used, section(".init3")));
+
+	void resetWakeEarly() {
+		uint8_t fromBootloader;
+		asm volatile ("mov %0, r2" : "=r" (fromBootloader));
+
+		bootMCUSR = MCUSR;
+		bootloaderCleared = !bootMCUSR;
+		if (bootloaderCleared) {
+		    bootMCUSR = fromBootloader;
+		}
+
+		MCUSR = 0;
+		wdt_disable();
+	}
+
+	//-------------------------------------------------------------
+	// Constructor. If this is a WDT reset that we asked for, and
+	// the block is intact, we have resumed. If a bootloader has
+	// cleared MCUSR, the magic number and CRC have to do on their
+	// own. Otherwise, start from nothing. Either way, disarm the
+	// magic number.
+	//-------------------------------------------------------------
+	AVR_resetWake::AVR_resetWake() :
+		wasResumed(false) {
+
+		wasResumed = (bootloaderCleared || (bootMCUSR & (1 << WDRF))) &&
+		             block.magic == RESETWAKE_MAGIC &&
+		             block.crc == blockCRC();
+
+		if (wasResumed) {
+		    block.wakes++;
+		} else {
+		    memset(&block, 0, sizeof(resetWakeBlock_t));
+		}
+
+		block.magic = 0;
+	}
+
+	uint8_t AVR_resetWake::resetCause() const {
+		return bootMCUSR;
+	}
+
+	void *AVR_resetWake::state() {
+		return block.state;
+	}
+
+	uint32_t AVR_resetWake::wakes() const {
+		return block.wakes;
+	}
+
+	//-------------------------------------------------------------
+	// Seal the state, let the USART finish, then sleep in power
+	// down with the WDT in reset mode. Any other interrupt just
+	// sends us back to sleep. Peripherals are powered off as
+	// goToSleep() would, as nothing will need them again.
+	//-------------------------------------------------------------
+	void AVR_resetWake::sleepUntilReset(const tickPeriod_t period) {
+		block.crc = blockCRC();
+		block.magic = RESETWAKE_MAGIC;
+
+		AVRsleep.drainUSART();
+
+		cli();
+		AVRsleep.writePRR(PRR | AVRsleep.sleepPRR());
+
+		wdt_reset();
+		MCUSR &= ~(1 << WDRF);
+		wdt_enable(period);
+
+		for (;;) {
+		    AVRsleep.nap(sleep::SM_POWER_DOWN);
+		}
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_resetWake object.
+//-------------------------------------------------------------
+sleep::AVR_resetWake AVRresetWake;
+
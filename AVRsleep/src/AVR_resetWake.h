@@ -0,0 +1,94 @@
+#ifndef AVR_RESETWAKE_H
+#define AVR_RESETWAKE_H
+
+/*============================================================
+ * The AVR_resetWake class sleeps in power down until the WDT
+ * resets the board, so that every wake starts clean. A small
+ * block of state is kept, over the reset, in RAM that the C
+ * runtime doesn't clear (the .noinit section) and is checked
+ * with a CRC on the way back up.
+ *
+ * The reset cause, MCUSR, is captured in .init3, before
+ * anything else runs, and the WDT is turned off there too, as
+ * it stays on, with its shortest period, after a WDT reset.
+ * setup() can then ask resumed() whether this is a planned
+ * wake, with good state, and skip its slow start up.
+ *
+ * If this class is used, MCUSR is always zero by the time
+ * setup() runs. Use resetCause() instead.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_tick.h"
+#include "AVR_crc.h"
+
+//-------------------------------------------------------------
+// How many bytes of sketch state are kept over the reset.
+//-------------------------------------------------------------
+#ifndef AVR_RESETWAKE_STATE_SIZE
+#define AVR_RESETWAKE_STATE_SIZE 16
+#endif
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// What is kept over the reset. The magic number is only
+	// written just before a planned reset, so that a WDT
+	// reset from a hang doesn't look like a wake.
+	//---------------------------------------------------------
+	typedef struct resetWakeBlock {
+	    uint16_t magic;
+	    uint16_t crc;
+	    uint32_t wakes;
+	    uint8_t state[AVR_RESETWAKE_STATE_SIZE];
+	} resetWakeBlock_t;
+
+
+	class AVR_resetWake {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor. Checks the kept block.
+		//---------------------------------------------------------
+		AVR_resetWake();
+
+		//---------------------------------------------------------
+		// Is this a planned wake, with good state?
+		//---------------------------------------------------------
+		bool resumed() const { return wasResumed; }
+
+		//---------------------------------------------------------
+		// MCUSR as it was at reset.
+		//---------------------------------------------------------
+		uint8_t resetCause() const;
+
+		//---------------------------------------------------------
+		// The sketch's state, zeroed if not resumed.
+		//---------------------------------------------------------
+		void *state();
+		uint8_t stateSize() const { return AVR_RESETWAKE_STATE_SIZE; }
+
+		//---------------------------------------------------------
+		// Planned wakes since the last cold start.
+		//---------------------------------------------------------
+		uint32_t wakes() const;
+
+		//---------------------------------------------------------
+		// Save the state, sleep and reset after the period. Does
+		// not return.
+		//---------------------------------------------------------
+		void sleepUntilReset(const tickPeriod_t period);
+
+	private:
+		bool wasResumed;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_resetWake AVRresetWake;
+
+#endif // AVR_RESETWAKE_H
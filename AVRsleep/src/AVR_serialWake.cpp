@@ -0,0 +1,96 @@
+#include "AVR_serialWake.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// The pin change function. Runs in the interrupt handler.
+	//-------------------------------------------------------------
+	static void rxChanged(const uint8_t pcint, const bool level) {
+		(void)pcint;
+		(void)level;
+		AVRserialWake.rxWake();
+	}
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_serialWake::AVR_serialWake() :
+		usart(),
+		woken(false)
+		{}
+
+	//-------------------------------------------------------------
+	// Save the USART set up and listen to RXD. If the USART is
+	// powered off, its registers can't be read, so we keep the
+	// set up saved last time. If there isn't one, with the
+	// receiver enabled, service() couldn't receive anything, so
+	// we refuse to arm.
+	//-------------------------------------------------------------
+	bool AVR_serialWake::arm() {
+		if (!(PRR & (1 << PRUSART0))) {
+		    usart.save();
+		}
+
+		if (!(usart.ucsrb & (1 << RXEN0))) {
+		    return false;
+		}
+
+		woken = false;
+		AVRpcint.attach(AVR_SERIALWAKE_RXD, rxChanged);
+		return true;
+	}
+
+	//-------------------------------------------------------------
+	// Stop listening to RXD.
+	//-------------------------------------------------------------
+	void AVR_serialWake::disarm() {
+		AVRpcint.detach(AVR_SERIALWAKE_RXD);
+	}
+
+	//-------------------------------------------------------------
+	// The start bit of a byte has arrived. We only need the one.
+	//-------------------------------------------------------------
+	void AVR_serialWake::rxWake() {
+		AVRpcint.disable(AVR_SERIALWAKE_RXD);
+		woken = true;
+	}
+
+	//-------------------------------------------------------------
+	// If we were woken by serial data, make sure the USART is
+	// powered and set up as it was when we were armed, then run a
+	// console session. The PRR bit for the USART is put back as
+	// it was afterwards.
+	//
+	// Returns true if a session was run.
+	//-------------------------------------------------------------
+	bool AVR_serialWake::service() {
+		if (!woken) {
+		    return false;
+		}
+
+		woken = false;
+		disarm();
+
+		uint8_t usartOff = PRR & (1 << PRUSART0);
+		if (usartOff) {
+		    AVRsleep.writePRR(PRR & ~(1 << PRUSART0));
+		    usart.restore();
+		}
+
+		AVRconsole.run();
+
+		if (usartOff) {
+		    AVRsleep.drainUSART();
+		    AVRsleep.writePRR(PRR | (1 << PRUSART0));
+		}
+
+		return true;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_serialWake object.
+//-------------------------------------------------------------
+sleep::AVR_serialWake AVRserialWake;
+
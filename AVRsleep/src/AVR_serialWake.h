@@ -0,0 +1,87 @@
+#ifndef AVR_SERIALWAKE_H
+#define AVR_SERIALWAKE_H
+
+/*============================================================
+ * The AVR_serialWake class lets the board be woken from
+ * power down by serial data. The USART can't do that itself,
+ * so a pin change interrupt is armed on RXD (PD0, PCINT16)
+ * before sleeping. The first edge wakes the board, the USART
+ * is powered and set up again, and an AVR_console session is
+ * run, asleep in idle between bytes, until no more data has
+ * arrived for the console's timeout.
+ *
+ * The byte that wakes the board will be lost or garbled, so
+ * the sender should start with a few preamble bytes, which
+ * the console will throw away. See AVR_console::setPreamble().
+ *
+ * Uses AVR_pcint and AVR_console, so the same restrictions on
+ * interrupt handlers apply.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_pcint.h"
+#include "AVR_console.h"
+
+//-------------------------------------------------------------
+// RXD is PD0, which is PCINT16.
+//-------------------------------------------------------------
+#define AVR_SERIALWAKE_RXD 16
+
+
+namespace sleep {
+
+	class AVR_serialWake {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_serialWake();
+
+		//---------------------------------------------------------
+		// Listen for serial data while asleep. Call just before
+		// sleeping, with the USART set up. Returns false if the
+		// USART is off and hasn't been seen set up.
+		//---------------------------------------------------------
+		bool arm();
+
+		//---------------------------------------------------------
+		// Stop listening.
+		//---------------------------------------------------------
+		void disarm();
+
+		//---------------------------------------------------------
+		// Did serial data wake us?
+		//---------------------------------------------------------
+		bool pending() const { return woken; }
+
+		//---------------------------------------------------------
+		// If serial data woke us, run a console session.
+		//---------------------------------------------------------
+		bool service();
+
+		//---------------------------------------------------------
+		// Called, from the pin change interrupt handler, only.
+		//---------------------------------------------------------
+		void rxWake();
+
+	private:
+		//---------------------------------------------------------
+		// The USART set up, saved by arm().
+		//---------------------------------------------------------
+		usartConfig_t usart;
+
+		//---------------------------------------------------------
+		// Set by the pin change interrupt.
+		//---------------------------------------------------------
+		volatile bool woken;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_serialWake AVRserialWake;
+
+#endif // AVR_SERIALWAKE_H
@@ -0,0 +1,143 @@
+#include "AVR_shortSleep.h"
+#include <util/delay_basic.h>
+
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Compare matches still to come. The interrupt handler turns
+	// itself off when this reaches zero.
+	//-------------------------------------------------------------
+	static volatile uint16_t matchesLeft = 0;
+
+	//-------------------------------------------------------------
+	// Timer 2's prescalers, indexed by clock select value - 1.
+	//-------------------------------------------------------------
+	static const uint16_t prescalers[] = {1, 8, 32, 64, 128, 256, 1024};
+
+	//-------------------------------------------------------------
+	// Busy wait for a number of CPU cycles. _delay_loop_2() takes
+	// 4 cycles per count.
+	//-------------------------------------------------------------
+	static void spin(uint32_t cycles) {
+		cycles /= 4;
+
+		while (cycles > 0xffff) {
+		    _delay_loop_2(0);
+		    cycles -= 0x10000;
+		}
+
+		if (cycles) {
+		    _delay_loop_2((uint16_t)cycles);
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Pick the smallest prescaler that gets the whole sleep into
+	// one trip round Timer 2, or the largest and a number of
+	// trips, then sleep in idle until the last compare match.
+	//-------------------------------------------------------------
+	void shortSleep(const uint16_t us) {
+		uint32_t cycles = (uint32_t)us * (F_CPU / 1000000UL);
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		//---------------------------------------------------------
+		// Someone else is using Timer 2's interrupts.
+		//---------------------------------------------------------
+		if (TIMSK2 & ((1 << OCIE2A) | (1 << OCIE2B) | (1 << TOIE2))) {
+		    SREG = oldSREG;
+		    spin(cycles);
+		    return;
+		}
+
+		uint8_t clockSelect = 1;
+		while (clockSelect < 7 && cycles > 256UL * prescalers[clockSelect - 1]) {
+		    clockSelect++;
+		}
+
+		uint32_t counts = cycles / prescalers[clockSelect - 1];
+		if (!counts) {
+		    SREG = oldSREG;
+		    return;
+		}
+
+		uint16_t matches = (counts + 255) / 256;
+		uint8_t top = (counts / matches) - 1;
+
+		//---------------------------------------------------------
+		// Power off what we can. The USART is left alone if it's
+		// still transmitting, and the ADC if it's converting.
+		//---------------------------------------------------------
+		uint8_t gate = (1 << PRTIM0) | (1 << PRTIM1) | (1 << PRUSART0) |
+		               (1 << PRSPI) | (1 << PRTWI) | (1 << PRADC);
+
+		if ((UCSR0B & (1 << UDRIE0)) || !(UCSR0A & (1 << UDRE0))) {
+		    gate &= ~(1 << PRUSART0);
+		}
+
+		if (ADCSRA & (1 << ADSC)) {
+		    gate &= ~(1 << PRADC);
+		}
+
+		gate = AVRsleep.allowedPRR(gate);
+
+		uint8_t oldPRR = PRR;
+		AVRsleep.writePRR((oldPRR | gate) & ~(1 << PRTIM2));
+
+		//---------------------------------------------------------
+		// Save Timer 2 and set it up in CTC mode.
+		//---------------------------------------------------------
+		uint8_t oldTCCR2A = TCCR2A;
+		uint8_t oldTCCR2B = TCCR2B;
+		uint8_t oldOCR2A = OCR2A;
+		uint8_t oldTCNT2 = TCNT2;
+
+		TCCR2B = 0;
+		TCNT2 = 0;
+		TCCR2A = (1 << WGM21);
+		OCR2A = top;
+		TIFR2 = (1 << OCF2A) | (1 << OCF2B) | (1 << TOV2);
+		matchesLeft = matches;
+		TIMSK2 = (1 << OCIE2A);
+		TCCR2B = clockSelect;
+
+		while (matchesLeft) {
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+
+		//---------------------------------------------------------
+		// Put Timer 2 back. The flags we raised are cleared, as
+		// nothing was using its interrupts when we started.
+		//---------------------------------------------------------
+		TCCR2B = 0;
+		TIMSK2 = 0;
+		TCNT2 = oldTCNT2;
+		OCR2A = oldOCR2A;
+		TCCR2A = oldTCCR2A;
+		TIFR2 = (1 << OCF2A) | (1 << OCF2B) | (1 << TOV2);
+		TCCR2B = oldTCCR2B;
+
+		AVRsleep.writePRR(oldPRR);
+
+		if (gate & (1 << PRTIM0)) {
+		    AVRsleep.creditMillis(us);
+		}
+
+		SREG = oldSREG;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// Count down the compare matches, and turn ourselves off after
+// the last one.
+//-------------------------------------------------------------
+ISR(TIMER2_COMPA_vect) {
+	AVRsleep.recordWake(sleep::WAKE_TIMER2);
+	if (sleep::matchesLeft && !--sleep::matchesLeft) {
+	    TIMSK2 &= ~(1 << OCIE2A);
+	}
+}
+
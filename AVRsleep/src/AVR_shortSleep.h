@@ -0,0 +1,33 @@
+#ifndef AVR_SHORTSLEEP_H
+#define AVR_SHORTSLEEP_H
+
+/*============================================================
+ * Short, accurate, sleeps of 100 uS to a few tens of mS, which
+ * the WDT can't manage. Timer 2 is run in CTC mode and its
+ * compare match interrupt wakes the board from idle. While
+ * asleep, Timers 0 and 1, the USART, SPI, TWI and ADC are all
+ * powered off, unless kept powered or locked through AVRsleep,
+ * or still busy.
+ *
+ * Timer 2's settings are saved and restored, so analogWrite()
+ * on pins 3 and 11 carries on afterwards, but the PWM output
+ * stops while asleep. If Timer 2's interrupts are in use, by
+ * tone() for example, we busy wait instead.
+ *
+ * This file owns the TIMER2_COMPA_vect interrupt handler, so it
+ * can't be used in the same sketch as tone().
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Sleep in idle for a number of microseconds.
+	//---------------------------------------------------------
+	void shortSleep(const uint16_t us);
+
+} // End of namespace.
+
+#endif // AVR_SHORTSLEEP_H
@@ -1,15 +1,43 @@
 #include "AVR_sleep.h"
+#include "AVR_energy.h"
+
+#ifdef ARDUINO
+//-------------------------------------------------------------
+// In the Arduino core's wiring.c.
+//-------------------------------------------------------------
+extern volatile unsigned long timer0_millis;
+extern volatile unsigned long timer0_overflow_count;
+#endif
 
 namespace sleep {
 
 	//-------------------------------------------------------------
-	// Constructor. Just nulls out the two function pointers.
+	// Constructor. Just nulls out the function pointers.
 	//-------------------------------------------------------------
 	AVR_sleep::AVR_sleep() :
 		ps(nullptr),
 		aw(nullptr),
+		wf(nullptr),
 		copyPRR(0),
-		powerBits(sleep::PM_NONE)
+		powerBits(sleep::PM_NONE),
+		keepBits(0),
+		lockBits(0),
+		lockCount(0),
+		lockRefs(),
+		loopExit(false),
+		wakeBits(0),
+		lastWakeBits(0),
+		wakeHandlers(),
+		stats(nullptr),
+		account(nullptr),
+		accountStamp(0),
+		accountUnits(0),
+		bodAsleep(false),
+		costClock(nullptr),
+		costs(nullptr),
+		clock(nullptr),
+		tr(nullptr),
+		lastSleepLength(0)
 		{}
 
 	//-------------------------------------------------------------
@@ -17,16 +45,9 @@ namespace sleep {
 	// cannot set timer 2 into asynchronous mode. So, those are 
 	// trapped and a suitable replacement mode used instead.
 	//-------------------------------------------------------------
-	void AVR_sleep::setSleepMode(
-		    const sleepMode_t sleepMode,
-		    const powerMode_t powerOffBits) {
-		
-		sleepMode_t mode = sleepMode;
+	sleepMode_t AVR_sleep::checkMode(const sleepMode_t sleepMode) {
 
-		//---------------------------------------------------------
-		// If the AC, BOD and WDT are to be powered off, record it!
-		//---------------------------------------------------------
-		powerBits = powerOffBits;
+		sleepMode_t mode = sleepMode;
 
 	#ifdef ARDUINO
 		//---------------------------------------------------------
@@ -43,20 +64,35 @@ namespace sleep {
 		    }
 		}
 	#endif
-		    
+
+		return mode;
+	}
+
+
+	//-------------------------------------------------------------
+	// Record the sleep mode and the peripherals to be powered off.
+	//-------------------------------------------------------------
+	void AVR_sleep::setSleepMode(
+		    const sleepMode_t sleepMode,
+		    const powerMode_t powerOffBits) {
+		
+		//---------------------------------------------------------
+		// If the AC, BOD and WDT are to be powered off, record it!
+		//---------------------------------------------------------
+		powerBits = powerOffBits;
+
 		//---------------------------------------------------------
 		// Set thenrequested sleep mode for later.
 		//---------------------------------------------------------
-		set_sleep_mode(mode);
+		set_sleep_mode(checkMode(sleepMode));
 	}
 
 
 	//-------------------------------------------------------------
-	// Puts the board to sleep. If the flag is set to power off the
-	// BOD (Brown Out Detector) then that needs doing within 3
-	// clock cycles -- need to be quick!
+	// Power off everything in the powerBits, except what is kept
+	// powered or guarded. Called with interrupts disabled.
 	//-------------------------------------------------------------
-	void AVR_sleep::goToSleep() {
+	void AVR_sleep::powerOff(const uint8_t guardBits) {
 
 		//---------------------------------------------------------
 		// Check the powerBits and if anything needs powering off,
@@ -68,8 +104,9 @@ namespace sleep {
 		//---------------------------------------------------------
 		copyPRR = PRR;
 
-		// Those flags that match the PRR register are easy.
-		PRR = (powerBits & 0x00ff);
+		// Those flags that match the PRR register are easy, but
+		// leave alone anything that has been asked to stay on.
+		PRR = (powerBits & 0x00ff) & ~(keepBits | guardBits);
 
 		//---------------------------------------------------------
 		// Now do the other peripherals not covered by the PRR. The
@@ -96,71 +133,213 @@ namespace sleep {
 		    MCUSR &= (1 << WDRF);
 		    wdt_disable();
 		}
+	}
+
+	//-------------------------------------------------------------
+	// Puts the board to sleep. If the flag is set to power off the
+	// BOD (Brown Out Detector) then that needs doing within 3
+	// clock cycles -- need to be quick!
+	//-------------------------------------------------------------
+	void AVR_sleep::goToSleep() {
+		goToSleep(nullptr);
+	}
+
+	//-------------------------------------------------------------
+	// Sleep, unless the test function says there is work to do.
+	// The test is made with interrupts disabled, immediately
+	// before sleeping, so an interrupt that makes work can't slip
+	// in between the test and the sleep and leave it undone until
+	// some other interrupt wakes us. It's also made before the
+	// pre sleep function, to save calling that for nothing. If
+	// the second test stops the sleep, the wake up function is
+	// still called, so that the two always pair up.
+	//-------------------------------------------------------------
+	bool AVR_sleep::goToSleep(const wakeTestFN test, const void *context) {
+
+		if (test && test(context)) {
+		    return false;
+		}
 
 		//---------------------------------------------------------
-		// Call preSleep function, if defined.
+		// Call preSleep function, if defined. This is done while
+		// everything is still powered, so that it can still use
+		// Serial etc.
 		//---------------------------------------------------------
 		if (ps) {
-		    (ps)();
+		    callCosted(ps, sleep::COST_PRE_SLEEP);
 		}
-		
+
 		//---------------------------------------------------------
-		// Save interrupt state and disable interrupts.
+		// If the USART is about to be powered off, or its clock
+		// stopped by any mode other than idle, let it finish
+		// transmitting first or the last few bytes are lost.
 		//---------------------------------------------------------
-		uint8_t oldSREG = SREG;
-		cli();
-		
+		if ((powerBits & ~keepBits & sleep::PM_USART_OFF) ||
+		    (SMCR & ((1 << SM2) | (1 << SM1) | (1 << SM0))) != SLEEP_MODE_IDLE) {
+		    drainUSART();
+		}
+
 		//---------------------------------------------------------
-		// Enable the sleep mode.
+		// Start timing the sleep, if there's a clock.
 		//---------------------------------------------------------
-		sleep_enable();
-		
+		uint32_t sleepStart = now();
+
 		//---------------------------------------------------------
-		// if disabling the BOD, we need to do it immediately prior
-		// to calling sleep_cpu(). We have only 3 clock cycles
-		// between disabling the BOD and calling sleep_cpu or it
-		// will not disable.
+		// Save interrupt state and disable interrupts. Everything
+		// from here on must be checked without anything changing
+		// underneath us.
 		//---------------------------------------------------------
-		if (powerBits & (1 << sleep::PM_BOD_OFF)) {
-		    sleep_bod_disable();
+		uint8_t oldSREG = SREG;
+		cli();
+
+		if (test && test(context)) {
+		    SREG = oldSREG;
+
+		    if (aw) {
+		        callCosted(aw, sleep::COST_AFTER_WAKE);
+		    }
+
+		    return false;
 		}
 
 		//---------------------------------------------------------
-		// Interrupts on, or we won't wake up!
+		// Forget any wake up sources recorded while we were awake.
 		//---------------------------------------------------------
-		sei();
+		wakeBits = 0;
 
 		//---------------------------------------------------------
-		// Sleepy time, bye byes!
+		// The transaction guard. If a transfer is in flight, or
+		// something holds a lock, the peripherals concerned stay
+		// powered and we only go into idle this time around. The
+		// sleep mode is put back afterwards, so the next sleep
+		// will be a deep one if things have finished.
 		//---------------------------------------------------------
-		sleep_cpu();
+		uint8_t guardBits = lockBits | busyPeripherals();
+		bool guarded = lockCount || guardBits;
 
-		//---------------------------------------------------------
-		// The microcontroller is now asleep. It will wake on an
-		// interrupt or a reset. If interrupted, it will continue
-		// with the remainder of this function. It will attempt to:
-		//
-		// 1. Disable sleep mode as required by the data sheet.
-		// 2. Restore the Power Reduction Register, but this may
-		//    re-enable TWI and SPI. Those will need to be set up
-		//    again in the afterWake() function.
-		// 3. Restore global interrupts, if they were enabled.
-		// 4. The Watch Dog Timer will NOT be restarted.
-		// 5. The previous sleep mode will be preserved for another
-		//    sleep session, but can be changed if necessary.
-		//---------------------------------------------------------
+		uint8_t oldSMCR = SMCR;
+		if (guarded) {
+		    set_sleep_mode(sleep::SM_IDLE);
+		}
 
-		// Zzzzzzzzzzzzzzzzzz! ;-)
+		powerOff(guardBits);
 
 		//---------------------------------------------------------
-		// When we get here, we were woken by an interrupt, not a
-		// reset.
+		// Count what was powered while awake, up to now, and what
+		// will be powered while asleep, from now.
 		//---------------------------------------------------------
+		if (account) {
+		    bodAsleep = !guarded && (powerBits & (1 << sleep::PM_BOD_OFF));
+		    accountPower();
+		    bodAsleep = false;
+		}
 
 		//---------------------------------------------------------
-		// Must disable sleep enable bit on wake.
+		// We may go round more than once, if the wake filter finds
+		// nothing to do.
 		//---------------------------------------------------------
-		sleep_disable();
+		for (;;) {
+		    //-----------------------------------------------------
+		    // Enable the sleep mode.
+		    //-----------------------------------------------------
+		    sleep_enable();
+		
+		    //-----------------------------------------------------
+		    // if disabling the BOD, we need to do it immediately prior
+		    // to calling sleep_cpu(). We have only 3 clock cycles
+		    // between disabling the BOD and calling sleep_cpu or it
+		    // will not disable. It's no use in idle anyway.
+		    //-----------------------------------------------------
+		    if (!guarded && (powerBits & (1 << sleep::PM_BOD_OFF))) {
+		        sleep_bod_disable();
+		    }
+
+		    //-----------------------------------------------------
+		    // Interrupts on, or we won't wake up!
+		    //-----------------------------------------------------
+		    sei();
+
+		    //-----------------------------------------------------
+		    // Sleepy time, bye byes!
+		    //-----------------------------------------------------
+		    sleep_cpu();
+
+		    //-----------------------------------------------------
+		    // The microcontroller is now asleep. It will wake on an
+		    // interrupt or a reset. If interrupted, it will continue
+		    // with the remainder of this function. It will attempt to:
+		    //
+		    // 1. Disable sleep mode as required by the data sheet.
+		    // 2. Restore the Power Reduction Register, but this may
+		    //    re-enable TWI and SPI. Those will need to be set up
+		    //    again in the afterWake() function.
+		    // 3. Restore global interrupts, if they were enabled.
+		    // 4. The Watch Dog Timer will NOT be restarted.
+		    // 5. The previous sleep mode will be preserved for another
+		    //    sleep session, but can be changed if necessary.
+		    //-----------------------------------------------------
+
+		    // Zzzzzzzzzzzzzzzzzz! ;-)
+
+		    //-----------------------------------------------------
+		    // When we get here, we were woken by an interrupt, not a
+		    // reset.
+		    //-----------------------------------------------------
+
+		    //-----------------------------------------------------
+		    // Must disable sleep enable bit on wake.
+		    //-----------------------------------------------------
+		    sleep_disable();
+
+		    //-----------------------------------------------------
+		    // The waking interrupt handler has run, and any others
+		    // that were pending, so note what woke us.
+		    //-----------------------------------------------------
+		    cli();
+		    lastWakeBits = wakeBits;
+
+		    if (stats) {
+		        countSleep(lastWakeBits);
+		    }
+
+		    //-----------------------------------------------------
+		    // The wake filter runs before anything is powered up.
+		    // If it says there's nothing to do, go straight back
+		    // to sleep, unless a lock has been taken meanwhile and
+		    // we are sleeping deeply, a peripheral we didn't guard
+		    // has gone busy, or the caller's test is now satisfied
+		    // by something an ISR did. Interrupts are still off, so
+		    // nothing can change between these checks and sleeping.
+		    //-----------------------------------------------------
+		    if (!wf || (lockCount && !guarded) ||
+		        (busyPeripherals() & ~guardBits) ||
+		        (test && test(context))) {
+		        break;
+		    }
+
+		    //-----------------------------------------------------
+		    // The cost clock may need something that's powered
+		    // off, Timer 0 for micros(), in which case the filter
+		    // is counted but its time comes out as zero.
+		    //-----------------------------------------------------
+		    uint32_t started = costStart();
+		    bool worthIt = (wf)(lastWakeBits);
+		    chargeCost(sleep::COST_WAKE_FILTER, started, PRR);
+
+		    if (worthIt) {
+		        break;
+		    }
+
+		    if (stats) {
+		        stats->resleeps++;
+		        stats->check++;
+		    }
+
+		    wakeBits = 0;
+		}
+
+		uint8_t sleptSMCR = SMCR;
+		SMCR = oldSMCR;
 
 		//---------------------------------------------------------
 		// Restore original PRR and global interrupt settings.
@@ -169,17 +348,380 @@ namespace sleep {
 		// wake up. Everything else carries on regardless. This can
 		// be done in the afterWake() function if necessary.
 		//---------------------------------------------------------
-		PRR = copyPRR;
+		writePRR(copyPRR);
 		SREG = oldSREG;
 
+		//---------------------------------------------------------
+		// How long were we asleep? Tell the trace, if any.
+		//---------------------------------------------------------
+		lastSleepLength = now() - sleepStart;
+
+		if (tr) {
+		    (tr)(sleptSMCR & ((1 << SM2) | (1 << SM1) | (1 << SM0)),
+		         lastWakeBits, lastSleepLength);
+		}
+
 		//---------------------------------------------------------
 		// Call afterWake function, if defined.
 		//---------------------------------------------------------
 		if (aw) {
-		    (aw)();
+		    callCosted(aw, sleep::COST_AFTER_WAKE);
+		}
+
+		//---------------------------------------------------------
+		// Then the handlers for whatever woke us.
+		//---------------------------------------------------------
+		dispatchWakes();
+
+		return true;
+	}
+
+	//-------------------------------------------------------------
+	// Count a sleep, in the mode it was taken in, and what woke
+	// us. The check total goes up with every count, so that the
+	// statistics can be checked after a reset.
+	//-------------------------------------------------------------
+	void AVR_sleep::countSleep(uint16_t woke) {
+		stats->sleeps[(SMCR >> 1) & 0x07]++;
+		stats->check++;
+
+		for (uint8_t source = 0; woke; source++, woke >>= 1) {
+		    if (woke & 1) {
+		        stats->wakes[source]++;
+		        stats->check++;
+		    }
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Call the handler for each wake up source recorded during the
+	// last sleep. Usually there's only one, so this is a single
+	// table lookup.
+	//-------------------------------------------------------------
+	void AVR_sleep::dispatchWakes() {
+		uint16_t woke = lastWakeBits;
+
+		for (uint8_t source = 0; woke; source++, woke >>= 1) {
+		    if ((woke & 1) && wakeHandlers[source]) {
+		        uint32_t started = costStart();
+		        uint8_t startPRR = PRR;
+		        (wakeHandlers[source])((wakeSource_t)source);
+		        chargeCost(sleep::COST_WAKE_HANDLER + source, started, startPRR);
+		    }
+		}
+	}
+
+	//-------------------------------------------------------------
+	// For firmware that does all its work in interrupt handlers.
+	// Everything goToSleep() does is done once, on the way in,
+	// and SE is left set, so going back to sleep after each
+	// interrupt costs only a test of the exit flag, the BOD
+	// disable if wanted, and the sleep instruction. The flag is
+	// tested with interrupts disabled, and the "sei" before the
+	// sleep instruction always lets the sleep instruction run
+	// first, so an exit can't be missed.
+	//
+	// The transaction guard is checked on the way in. After that,
+	// only the lock count is checked, and while a lock is held we
+	// sleep in idle.
+	//-------------------------------------------------------------
+	void AVR_sleep::runEventLoop() {
+
+		if (ps) {
+		    callCosted(ps, sleep::COST_PRE_SLEEP);
+		}
+
+		if ((powerBits & ~keepBits & sleep::PM_USART_OFF) ||
+		    (SMCR & ((1 << SM2) | (1 << SM1) | (1 << SM0))) != SLEEP_MODE_IDLE) {
+		    drainUSART();
+		}
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		uint8_t guardBits = lockBits | busyPeripherals();
+		bool guarded = lockCount || guardBits;
+
+		uint8_t oldSMCR = SMCR;
+		if (guarded) {
+		    set_sleep_mode(sleep::SM_IDLE);
+		}
+
+		powerOff(guardBits);
+		sleep_enable();
+
+		uint8_t deepSMCR = SMCR;
+		uint8_t idleSMCR = (1 << SE) | SLEEP_MODE_IDLE;
+		bool bodOff = !guarded && (powerBits & (1 << sleep::PM_BOD_OFF));
+
+		if (account) {
+		    bodAsleep = bodOff;
+		    accountPower();
+		    bodAsleep = false;
+		}
+
+		loopExit = false;
+
+		while (!loopExit) {
+		    if (lockCount) {
+		        SMCR = idleSMCR;
+		        sei();
+		        sleep_cpu();
+		        cli();
+		        SMCR = deepSMCR;
+		        continue;
+		    }
+
+		    if (bodOff) {
+		        sleep_bod_disable();
+		    }
+
+		    sei();
+		    sleep_cpu();
+		    cli();
+		}
+
+		sleep_disable();
+		SMCR = oldSMCR;
+
+		writePRR(copyPRR);
+		SREG = oldSREG;
+
+		if (aw) {
+		    callCosted(aw, sleep::COST_AFTER_WAKE);
 		}
 	}
 
+	//-------------------------------------------------------------
+	// Wait for the USART to finish transmitting. If the serial
+	// driver is interrupt driven, as the Arduino's Serial is, we
+	// sleep in idle while its buffer empties, waking on each UDRE
+	// interrupt. That leaves, at most, one byte in UDR0 and one in
+	// the shift register, which are waited for on TXC0. As nothing
+	// is guaranteed to wake us for those, that part is a bounded
+	// busy wait of no more than a couple of frames.
+	//-------------------------------------------------------------
+	void AVR_sleep::drainUSART() {
+
+		//---------------------------------------------------------
+		// Nothing to do if the USART is off, or not transmitting.
+		//---------------------------------------------------------
+		if ((PRR & (1 << PRUSART0)) || !(UCSR0B & (1 << TXEN0))) {
+		    return;
+		}
+
+		bool busy = false;
+
+		uint8_t oldSREG = SREG;
+		cli();
+		while (UCSR0B & (1 << UDRIE0)) {
+		    busy = true;
+		    nap(sleep::SM_IDLE);
+		}
+		SREG = oldSREG;
+
+		//---------------------------------------------------------
+		// A frame is at most 12 bits. Each pass around the loops
+		// below takes at least 8 cycles.
+		//---------------------------------------------------------
+		uint32_t loops = (uint32_t)(UBRR0 + 1) *
+		                 ((UCSR0A & (1 << U2X0)) ? 8 : 16) * 12 * 2 / 8;
+
+		while (!(UCSR0A & (1 << UDRE0)) && loops) {
+		    busy = true;
+		    loops--;
+		}
+
+		//---------------------------------------------------------
+		// TXC0 might be left over from an earlier transmission if
+		// the driver doesn't clear it, so if we saw data going
+		// out, clear it and wait for the last frame. If we saw
+		// nothing, and TXC0 is set, we are done. Otherwise we
+		// can't tell, so wait out the loop. The other bits in
+		// UCSR0A must be written as zero.
+		//---------------------------------------------------------
+		if (busy) {
+		    UCSR0A = (UCSR0A & ((1 << U2X0) | (1 << MPCM0))) | (1 << TXC0);
+		}
+
+		while (!(UCSR0A & (1 << TXC0)) && loops) {
+		    loops--;
+		}
+	}
+
+
+	//-------------------------------------------------------------
+	// A single, bare, sleep in the requested mode. This is for
+	// code that has to wait for an interrupt driven event, and
+	// must be called with interrupts disabled. It returns with
+	// them disabled again so that the wait condition can be
+	// tested without a race between the test and the sleep:
+	//
+	//    cli();
+	//    while (!done) {
+	//        AVRsleep.nap(sleep::SM_IDLE);
+	//    }
+	//    sei();
+	//
+	// The PRR, powerBits and the attached functions are left
+	// alone, and the sleep mode set by setSleepMode() is put
+	// back afterwards.
+	//-------------------------------------------------------------
+	void AVR_sleep::nap(const sleepMode_t sleepMode) {
+
+		uint8_t oldSMCR = SMCR;
+		set_sleep_mode(checkMode(sleepMode));
+		sleep_enable();
+
+		//---------------------------------------------------------
+		// The instruction after sei() is always executed before
+		// any pending interrupt, so nothing can sneak in between
+		// the caller's test and the sleep.
+		//---------------------------------------------------------
+		sei();
+		sleep_cpu();
+
+		sleep_disable();
+		cli();
+		SMCR = oldSMCR;
+	}
+
+	//-------------------------------------------------------------
+	// Take a transaction lock. While any lock is held, goToSleep()
+	// will only go into idle, and will not power off the locked
+	// peripherals. Code that drives the SPI or TWI, an SD card
+	// write for example, should lock for the whole transaction.
+	// Each peripheral has its own count of locks, so two users of
+	// the SPI can overlap, and it stays powered until both have
+	// unlocked. PM_NONE just stops deep sleep.
+	//
+	// These can be called from interrupt handlers.
+	//-------------------------------------------------------------
+	void AVR_sleep::lock(const powerMode_t peripherals) {
+		uint8_t oldSREG = SREG;
+		cli();
+
+		lockCount++;
+
+		uint8_t bits = peripherals & sleep::PM_PRR_OFF;
+		for (uint8_t bit = 0; bits; bit++, bits >>= 1) {
+		    if (bits & 1) {
+		        lockRefs[bit]++;
+		        lockBits |= (1 << bit);
+		    }
+		}
+
+		SREG = oldSREG;
+	}
+
+	void AVR_sleep::unlock(const powerMode_t peripherals) {
+		uint8_t oldSREG = SREG;
+		cli();
+
+		if (lockCount) {
+		    lockCount--;
+		}
+
+		uint8_t bits = peripherals & sleep::PM_PRR_OFF;
+		for (uint8_t bit = 0; bits; bit++, bits >>= 1) {
+		    if ((bits & 1) && lockRefs[bit] && !--lockRefs[bit]) {
+		        lockBits &= ~(1 << bit);
+		    }
+		}
+
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Check the hardware for SPI and TWI transfers in flight. The
+	// registers can't tell us everything, a polled SPI transfer
+	// looks just like an idle SPI for example, so locks are still
+	// needed. Returns the PRR bits of the busy peripherals.
+	//
+	// SPI: an interrupt driven transfer has finished, and its
+	//      interrupt handler is about to start the next one.
+	// TWI: a START or STOP is still being sent, or the TWI is
+	//      part way through a transaction, waiting for software
+	//      to tell it what to do next.
+	//-------------------------------------------------------------
+	uint8_t AVR_sleep::busyPeripherals() {
+		uint8_t busy = 0;
+
+		if (!(PRR & (1 << PRSPI)) &&
+		    (SPCR & ((1 << SPE) | (1 << SPIE))) == ((1 << SPE) | (1 << SPIE)) &&
+		    (SPSR & (1 << SPIF))) {
+		    busy |= sleep::PM_SPI_OFF;
+		}
+
+		if (!(PRR & (1 << PRTWI)) && (TWCR & (1 << TWEN))) {
+		    if ((TWCR & ((1 << TWSTA) | (1 << TWSTO))) ||
+		        ((TWCR & (1 << TWINT)) && (TWSR & 0xF8) != 0xF8)) {
+		        busy |= sleep::PM_TWI_OFF;
+		    }
+		}
+
+		return busy;
+	}
+
+	//-------------------------------------------------------------
+	// The PRR peripherals that goToSleep() would power off right
+	// now. For code that wants to save power in the same way as
+	// goToSleep(), without going through it.
+	//-------------------------------------------------------------
+	uint8_t AVR_sleep::sleepPRR() const {
+		return allowedPRR(powerBits & 0x00ff);
+	}
+
+	//-------------------------------------------------------------
+	// Take out any peripherals that are kept powered, locked, or
+	// part way through a transfer.
+	//-------------------------------------------------------------
+	uint8_t AVR_sleep::allowedPRR(const uint8_t prrBits) const {
+		return prrBits & ~(keepBits | lockBits | busyPeripherals());
+	}
+
+	//-------------------------------------------------------------
+	// Timer 0 doesn't run in power down, or when it's powered off,
+	// so millis() needs moving on by the time it was stopped. So
+	// does micros(), which counts Timer 0 overflows, separately.
+	// The odd microseconds are kept for next time, for each.
+	//-------------------------------------------------------------
+	void AVR_sleep::creditMillis(const uint32_t us) {
+	#ifdef ARDUINO
+		const uint16_t overflowMicros = 64UL * 256 * 1000000UL / F_CPU;
+		static uint16_t spareMillis = 0;
+		static uint16_t spareOverflow = 0;
+
+		uint32_t total = us + spareMillis;
+		spareMillis = total % 1000;
+
+		uint32_t overflows = us + spareOverflow;
+		spareOverflow = overflows % overflowMicros;
+
+		uint8_t oldSREG = SREG;
+		cli();
+		timer0_millis += total / 1000;
+		timer0_overflow_count += overflows / overflowMicros;
+		SREG = oldSREG;
+	#else
+		(void)us;
+	#endif
+	}
+
+	//-------------------------------------------------------------
+	// Some parts of the library need a peripheral to stay powered
+	// while asleep, the TWI for a slave address match for example,
+	// whatever setSleepMode() was told. Only the PRR peripherals
+	// can be kept on like this.
+	//-------------------------------------------------------------
+	void AVR_sleep::keepPowered(const powerMode_t peripherals) {
+		keepBits |= (peripherals & sleep::PM_PRR_OFF);
+	}
+
+	void AVR_sleep::allowPowerOff(const powerMode_t peripherals) {
+		keepBits &= ~(peripherals & sleep::PM_PRR_OFF);
+	}
+
 	//-------------------------------------------------------------
 	// Attach a function to call before sleeping.
 	//-------------------------------------------------------------
@@ -194,6 +736,223 @@ namespace sleep {
 		aw = awfn;
 	}
 
+	//-------------------------------------------------------------
+	// Count sleeps and wakes, or stop counting with nullptr.
+	//-------------------------------------------------------------
+	void AVR_sleep::attachStats(sleepStats_t *sleepStats) {
+		uint8_t oldSREG = SREG;
+		cli();
+		stats = sleepStats;
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Start profiling callbacks. The table, if any, isn't cleared.
+	//-------------------------------------------------------------
+	void AVR_sleep::attachProfiler(const clockFN cfn, callbackCost_t *costTable) {
+		costClock = cfn;
+		costs = cfn ? costTable : nullptr;
+	}
+
+	//-------------------------------------------------------------
+	// Add a call's time, and its charge, to its cost. Whatever was
+	// powered at either end is taken to have been powered all the
+	// way through. The charge is worked out in two halves, so a
+	// long call doesn't overflow the multiplication.
+	//-------------------------------------------------------------
+	void AVR_sleep::addCost(
+		    callbackCost_t &cost,
+		    const uint32_t started,
+		    const uint8_t startPRR) const {
+
+		if (!costClock) {
+		    return;
+		}
+
+		uint32_t elapsed = (costClock)() - started;
+		uint32_t current = sleep::awakeMicroamps(~(startPRR & PRR));
+
+		cost.calls++;
+		cost.time += elapsed;
+		cost.charge += current * (elapsed / 1000) +
+		               current * (elapsed % 1000) / 1000;
+	}
+
+	void AVR_sleep::callCosted(const afterWakeFN fn, const uint8_t index) {
+		uint32_t started = costStart();
+		uint8_t startPRR = PRR;
+
+		(fn)();
+		chargeCost(index, started, startPRR);
+	}
+
+	//-------------------------------------------------------------
+	// Pick out the costliest entries, most first, by inserting
+	// each one into the list in order. Entries that were never
+	// called are left out.
+	//-------------------------------------------------------------
+	uint8_t AVR_sleep::topCosts(uint8_t *top, const uint8_t count) const {
+		uint8_t found = 0;
+
+		if (!costs) {
+		    return 0;
+		}
+
+		for (uint8_t index = 0; index < sleep::COST_ENTRIES; index++) {
+		    if (!costs[index].calls) {
+		        continue;
+		    }
+
+		    uint8_t slot = found < count ? found++ : count;
+		    while (slot && costs[top[slot - 1]].charge < costs[index].charge) {
+		        if (slot < count) {
+		            top[slot] = top[slot - 1];
+		        }
+		        slot--;
+		    }
+
+		    if (slot < count) {
+		        top[slot] = index;
+		    }
+		}
+
+		return found;
+	}
+
+	//-------------------------------------------------------------
+	// Start counting power on time from now.
+	//-------------------------------------------------------------
+	void AVR_sleep::attachPowerAccount(powerAccount_t *powerAccount) {
+		uint8_t oldSREG = SREG;
+		cli();
+		account = powerAccount;
+		accountStamp = now();
+		accountUnits = poweredUnits();
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Every PRR write in the library comes through here, so each
+	// change of peripheral power is timestamped. Without a power
+	// account, it's just the write.
+	//-------------------------------------------------------------
+	void AVR_sleep::writePRR(const uint8_t value) {
+		uint8_t oldSREG = SREG;
+		cli();
+		PRR = value;
+
+		if (account) {
+		    accountPower();
+		}
+
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Credit the time since we last counted to whatever was
+	// powered then, and note what's powered now. A clock that
+	// goes backwards, as AVRtick's does when restarted, or when
+	// its 16 bit count wraps, loses the time in between.
+	//-------------------------------------------------------------
+	void AVR_sleep::accountPower() {
+		uint8_t oldSREG = SREG;
+		cli();
+
+		if (account) {
+		    uint32_t stamp = now();
+		    uint32_t elapsed = stamp >= accountStamp ? stamp - accountStamp : 0;
+		    uint16_t units = accountUnits;
+
+		    for (uint8_t unit = 0; units; unit++, units >>= 1) {
+		        if (units & 1) {
+		            account->onTime[unit] += elapsed;
+		        }
+		    }
+
+		    account->elapsed += elapsed;
+		    accountStamp = stamp;
+		    accountUnits = poweredUnits();
+		}
+
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// A PRR peripheral is powered when its bit is clear. The BOD
+	// is taken to be on, as the fuses can't be read cheaply,
+	// except while goToSleep() has it turned off.
+	//-------------------------------------------------------------
+	uint16_t AVR_sleep::poweredUnits() const {
+		uint16_t units = ~PRR & sleep::PM_PRR_OFF;
+
+		if (!(ACSR & (1 << ACD))) {
+		    units |= (1 << sleep::PM_AC_OFF);
+		}
+
+		if (!bodAsleep) {
+		    units |= (1 << sleep::PM_BOD_OFF);
+		}
+
+		if (WDTCSR & ((1 << WDIE) | (1 << WDE))) {
+		    units |= (1 << sleep::PM_WDT_OFF);
+		}
+
+		return units;
+	}
+
+	//-------------------------------------------------------------
+	// Attach a clock, for timing sleeps.
+	//-------------------------------------------------------------
+	void AVR_sleep::attachClock(const clockFN cfn) {
+		clock = cfn;
+	}
+
+	//-------------------------------------------------------------
+	// Attach a function to be told about each sleep.
+	//-------------------------------------------------------------
+	void AVR_sleep::attachTrace(const sleepTraceFN stfn) {
+		tr = stfn;
+	}
+
+	//-------------------------------------------------------------
+	// Attach a function to filter out wakes with nothing to do.
+	//-------------------------------------------------------------
+	void AVR_sleep::attachWakeFilter(const wakeFilterFN wffn) {
+		wf = wffn;
+	}
+
+	//-------------------------------------------------------------
+	// Attach a function to a wake up source. Pass nullptr to
+	// detach it.
+	//-------------------------------------------------------------
+	void AVR_sleep::attachWakeHandler(const wakeSource_t source, const wakeHandlerFN whfn) {
+		if (source < sleep::WAKE_SOURCES) {
+		    wakeHandlers[source] = whfn;
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Save the USART settings. Only U2X0 is worth keeping from
+	// UCSR0A, the rest are flags. The USART must be powered.
+	//-------------------------------------------------------------
+	void usartConfig::save() {
+		ubrr = UBRR0;
+		ucsra = UCSR0A & (1 << U2X0);
+		ucsrb = UCSR0B;
+		ucsrc = UCSR0C;
+	}
+
+	//-------------------------------------------------------------
+	// Write the USART settings back. UCSR0B goes last, as that
+	// enables the transmitter and receiver.
+	//-------------------------------------------------------------
+	void usartConfig::restore() const {
+		UBRR0 = ubrr;
+		UCSR0A = ucsra;
+		UCSR0C = ucsrc;
+		UCSR0B = ucsrb;
+	}
+
 } // End of namespace.
 
 //-------------------------------------------------------------
@@ -18,6 +18,7 @@
 #include "avr/sleep.h"
 #include "avr/interrupt.h"
 #include <stdint.h>
+#include "AVR_sleepTypes.h"
 
 
 
@@ -57,6 +58,12 @@ namespace sleep {
 	// Call here after wake up.
 	//---------------------------------------------------------
 	typedef void (*afterWakeFN)();
+
+	//---------------------------------------------------------
+	// Called with interrupts disabled, just before sleeping.
+	// Return true if there is already something to do.
+	//---------------------------------------------------------
+	typedef bool (*wakeTestFN)(const void *context);
 	
 	//---------------------------------------------------------
 	// Typedef for the various sleep modes. These are
@@ -100,6 +107,48 @@ namespace sleep {
 	    PM_EVERYTHING_OFF = 0x07ef  // Everything off
 	} powerMode_t;
 
+	//---------------------------------------------------------
+	// Call here after wake up, for one wake up source.
+	//---------------------------------------------------------
+	typedef void (*wakeHandlerFN)(const wakeSource_t source);
+
+	//---------------------------------------------------------
+	// Called straight after waking, with interrupts disabled
+	// and everything still powered off. Return false to go
+	// back to sleep.
+	//---------------------------------------------------------
+	typedef bool (*wakeFilterFN)(const uint16_t wokenBy);
+
+	//---------------------------------------------------------
+	// Returns the time, in any units, from a clock that keeps
+	// running while asleep.
+	//---------------------------------------------------------
+	typedef uint32_t (*clockFN)();
+
+	//---------------------------------------------------------
+	// Called after each sleep with the SMCR sleep mode bits,
+	// the wake up sources and the clock time asleep.
+	//---------------------------------------------------------
+	typedef void (*sleepTraceFN)(const uint8_t sleepMode,
+	                             const uint16_t wokenBy,
+	                             const uint32_t length);
+
+
+	//---------------------------------------------------------
+	// The USART's settings. The USART must be set up again
+	// after it has been powered off in the PRR, so these can
+	// be saved before, and written back after.
+	//---------------------------------------------------------
+	typedef struct usartConfig {
+	    uint16_t ubrr;
+	    uint8_t ucsra;
+	    uint8_t ucsrb;
+	    uint8_t ucsrc;
+
+	    void save();
+	    void restore() const;
+	} usartConfig_t;
+
 
 	class AVR_sleep {
 
@@ -122,6 +171,30 @@ namespace sleep {
 		// Do it.
 		//---------------------------------------------------------
 		void goToSleep();
+
+		//---------------------------------------------------------
+		// Do it, unless the test says there's work to do. Returns
+		// true if we slept.
+		//---------------------------------------------------------
+		bool goToSleep(const wakeTestFN test, const void *context = nullptr);
+
+		//---------------------------------------------------------
+		// Sleep, waking only to run interrupt handlers, until one
+		// of them calls exitEventLoop().
+		//---------------------------------------------------------
+		void runEventLoop();
+		void exitEventLoop() { loopExit = true; }
+
+		//---------------------------------------------------------
+		// A single bare sleep, for library modules that need to
+		// wait on something. Call with interrupts disabled.
+		//---------------------------------------------------------
+		void nap(const sleepMode_t sleepMode);
+
+		//---------------------------------------------------------
+		// Wait, mostly asleep, for the USART to stop transmitting.
+		//---------------------------------------------------------
+		void drainUSART();
 		
 		//---------------------------------------------------------
 		// Attach sketch functions to pre/post sleep.
@@ -129,7 +202,175 @@ namespace sleep {
 		void attachPreSleep(const preSleepFN psfn);
 		void attachWakeUp(const afterWakeFN awfn);
 
+		//---------------------------------------------------------
+		// Attach a function to a wake up source. After waking,
+		// and after the afterWakeFN, the function for each source
+		// that was recorded while asleep is called.
+		//---------------------------------------------------------
+		void attachWakeHandler(const wakeSource_t source, const wakeHandlerFN whfn);
+
+		//---------------------------------------------------------
+		// Attach a filter for spurious wakes.
+		//---------------------------------------------------------
+		void attachWakeFilter(const wakeFilterFN wffn);
+
+		//---------------------------------------------------------
+		// Count sleeps and wakes into a statistics block.
+		//---------------------------------------------------------
+		void attachStats(sleepStats_t *sleepStats);
+
+		//---------------------------------------------------------
+		// Count the time and charge each callback costs, by a
+		// clock that's fine enough to time them, into a table of
+		// COST_ENTRIES, if there is one.
+		//---------------------------------------------------------
+		void attachProfiler(const clockFN cfn, callbackCost_t *costTable = nullptr);
+
+		//---------------------------------------------------------
+		// Time a callback: read the profiler's clock before, and
+		// add the cost afterwards. Used by AVR_tasks too.
+		//---------------------------------------------------------
+		uint32_t costStart() const { return costClock ? (costClock)() : 0; }
+		void addCost(callbackCost_t &cost,
+		             const uint32_t started,
+		             const uint8_t startPRR) const;
+
+		//---------------------------------------------------------
+		// The costIndex_t of the costliest callbacks, by charge,
+		// most first. Returns how many there are.
+		//---------------------------------------------------------
+		uint8_t topCosts(uint8_t *top, const uint8_t count) const;
+
+		//---------------------------------------------------------
+		// Count how long each unit is powered for, by the clock.
+		//---------------------------------------------------------
+		void attachPowerAccount(powerAccount_t *powerAccount);
+
+		//---------------------------------------------------------
+		// Write the PRR. Library modules use this, so the time
+		// each peripheral is powered can be counted.
+		//---------------------------------------------------------
+		void writePRR(const uint8_t value);
+
+		//---------------------------------------------------------
+		// Bring the power account up to date. Call after turning
+		// the AC or WDT on or off, and before reading it.
+		//---------------------------------------------------------
+		void accountPower();
+
+		//---------------------------------------------------------
+		// Which units are powered now, as powerMode_t bits.
+		//---------------------------------------------------------
+		uint16_t poweredUnits() const;
+
+		//---------------------------------------------------------
+		// The statistics block being counted into, if any.
+		//---------------------------------------------------------
+		const sleepStats_t *statistics() const { return stats; }
+
+		//---------------------------------------------------------
+		// What setSleepMode() set.
+		//---------------------------------------------------------
+		sleepMode_t sleepMode() const {
+		    return (sleepMode_t)(SMCR & ((1 << SM2) | (1 << SM1) | (1 << SM0)));
+		}
+		powerMode_t powerMode() const { return powerBits; }
+
+		//---------------------------------------------------------
+		// Attach a clock for timing sleeps, and read it. Returns
+		// zero if there isn't one.
+		//---------------------------------------------------------
+		void attachClock(const clockFN cfn);
+		uint32_t now() const { return clock ? (clock)() : 0; }
+
+		//---------------------------------------------------------
+		// How long the last sleep took, by the clock.
+		//---------------------------------------------------------
+		uint32_t lastSleep() const { return lastSleepLength; }
+
+		//---------------------------------------------------------
+		// Attach a function to be told about each sleep.
+		//---------------------------------------------------------
+		void attachTrace(const sleepTraceFN stfn);
+
+		//---------------------------------------------------------
+		// Record a wake up source. Call from interrupt handlers.
+		//---------------------------------------------------------
+		void recordWake(const wakeSource_t source) { wakeBits |= (1 << source); }
+
+		//---------------------------------------------------------
+		// The sources recorded during the last sleep, as bits.
+		//---------------------------------------------------------
+		uint16_t wokenBy() const { return lastWakeBits; }
+
+		//---------------------------------------------------------
+		// Keep PRR peripherals powered while asleep, or not.
+		//---------------------------------------------------------
+		void keepPowered(const powerMode_t peripherals);
+		void allowPowerOff(const powerMode_t peripherals);
+
+		//---------------------------------------------------------
+		// Transaction locks. No deep sleep while one is held.
+		//---------------------------------------------------------
+		void lock(const powerMode_t peripherals = sleep::PM_NONE);
+		void unlock(const powerMode_t peripherals = sleep::PM_NONE);
+
+		//---------------------------------------------------------
+		// PRR bits of SPI/TWI transfers still in flight.
+		//---------------------------------------------------------
+		static uint8_t busyPeripherals();
+
+		//---------------------------------------------------------
+		// Is a lock held? What would goToSleep() write to PRR?
+		//---------------------------------------------------------
+		bool isLocked() const { return lockCount; }
+		uint8_t sleepPRR() const;
+
+		//---------------------------------------------------------
+		// Which of these PRR bits can be powered off right now?
+		//---------------------------------------------------------
+		uint8_t allowedPRR(const uint8_t prrBits) const;
+
+		//---------------------------------------------------------
+		// Move millis() and micros() on after Timer 0 has been
+		// stopped. Does nothing without the Arduino core.
+		//---------------------------------------------------------
+		static void creditMillis(const uint32_t us);
+
 	private:
+		//---------------------------------------------------------
+		// Swap out modes that the Arduino can't use.
+		//---------------------------------------------------------
+		static sleepMode_t checkMode(const sleepMode_t sleepMode);
+
+		//---------------------------------------------------------
+		// Power off what we can. Saves the PRR in copyPRR.
+		//---------------------------------------------------------
+		void powerOff(const uint8_t guardBits);
+
+		//---------------------------------------------------------
+		// Call the wake handlers.
+		//---------------------------------------------------------
+		void dispatchWakes();
+
+		//---------------------------------------------------------
+		// Add a sleep to the statistics.
+		//---------------------------------------------------------
+		void countSleep(uint16_t woke);
+
+		//---------------------------------------------------------
+		// Call a pre sleep or after wake function, and count its
+		// cost, if we're profiling.
+		//---------------------------------------------------------
+		void callCosted(const afterWakeFN fn, const uint8_t index);
+		void chargeCost(const uint8_t index,
+		                const uint32_t started,
+		                const uint8_t startPRR) const {
+		    if (costs) {
+		        addCost(costs[index], started, startPRR);
+		    }
+		}
+
 		//---------------------------------------------------------
 		// Function to call before going to sleep.
 		//---------------------------------------------------------
@@ -140,6 +381,11 @@ namespace sleep {
 		//---------------------------------------------------------
 		afterWakeFN aw;
 
+		//---------------------------------------------------------
+		// Function to decide if a wake up was worth it.
+		//---------------------------------------------------------
+		wakeFilterFN wf;
+
 		//---------------------------------------------------------
 		// Saved copy of the PRR register. Restored after wake up.
 		//---------------------------------------------------------
@@ -149,6 +395,68 @@ namespace sleep {
 		// Flags for everything we are turning off.
 		//---------------------------------------------------------
 		powerMode_t powerBits;
+
+		//---------------------------------------------------------
+		// PRR bits for peripherals that must stay powered.
+		//---------------------------------------------------------
+		uint8_t keepBits;
+
+		//---------------------------------------------------------
+		// PRR bits of locked peripherals, and how many locks are
+		// held. Changed by interrupt handlers too.
+		//---------------------------------------------------------
+		volatile uint8_t lockBits;
+		volatile uint8_t lockCount;
+
+		//---------------------------------------------------------
+		// Locks held on each peripheral, by PRR bit number.
+		//---------------------------------------------------------
+		volatile uint8_t lockRefs[8];
+
+		//---------------------------------------------------------
+		// Set by exitEventLoop().
+		//---------------------------------------------------------
+		volatile bool loopExit;
+
+		//---------------------------------------------------------
+		// Wake up sources, as recorded by interrupt handlers, and
+		// as they were at the end of the last sleep.
+		//---------------------------------------------------------
+		volatile uint16_t wakeBits;
+		uint16_t lastWakeBits;
+
+		//---------------------------------------------------------
+		// A function per wake up source.
+		//---------------------------------------------------------
+		wakeHandlerFN wakeHandlers[sleep::WAKE_SOURCES];
+
+		//---------------------------------------------------------
+		// Where to count sleeps, if anywhere.
+		//---------------------------------------------------------
+		sleepStats_t *stats;
+
+		//---------------------------------------------------------
+		// Where to count power on time, if anywhere, when we last
+		// counted, what was powered then, and whether the BOD is
+		// off while we sleep.
+		//---------------------------------------------------------
+		powerAccount_t *account;
+		uint32_t accountStamp;
+		uint16_t accountUnits;
+		bool bodAsleep;
+
+		//---------------------------------------------------------
+		// The profiler's clock, and its table of costs.
+		//---------------------------------------------------------
+		clockFN costClock;
+		callbackCost_t *costs;
+
+		//---------------------------------------------------------
+		// The clock, the trace function, and the last sleep time.
+		//---------------------------------------------------------
+		clockFN clock;
+		sleepTraceFN tr;
+		uint32_t lastSleepLength;
 	};
 
 } // End of namespace.
@@ -0,0 +1,89 @@
+#ifndef AVR_SLEEPTYPES_H
+#define AVR_SLEEPTYPES_H
+
+/*============================================================
+ * Types that are shared with the host tools in extras/tools,
+ * so this header has no AVR dependencies.
+ *===========================================================*/
+
+#include <stdint.h>
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Wake up sources. The library's interrupt handlers record
+	// themselves; a sketch's own handlers should do the same
+	// with recordWake(). These are bit numbers in wokenBy().
+	//---------------------------------------------------------
+	typedef enum wakeSource : uint8_t {
+	    WAKE_WDT = 0,                       // AVR_tick
+	    WAKE_PCINT0,                        // AVR_pcint, PB0-PB7
+	    WAKE_PCINT1,                        // AVR_pcint, PC0-PC6
+	    WAKE_PCINT2,                        // AVR_pcint, PD0-PD7
+	    WAKE_INT0,
+	    WAKE_INT1,
+	    WAKE_TWI,                           // AVR_twiSlave
+	    WAKE_USART,
+	    WAKE_ADC,                           // AVR_await
+	    WAKE_EEPROM,                        // AVR_await
+	    WAKE_SPI,                           // AVR_await
+	    WAKE_TIMER2,                        // AVR_shortSleep
+	    WAKE_TIMER,                         // Timer 0 or 1
+	    WAKE_OTHER,
+	    WAKE_SOURCES                        // How many
+	} wakeSource_t;
+
+	//---------------------------------------------------------
+	// Sleep statistics, counted by goToSleep() once attached.
+	// Sleeps are indexed by the SMCR sleep mode bits, SM2:0.
+	// The check total is the sum of all the other counts.
+	//---------------------------------------------------------
+	typedef struct sleepStats {
+	    uint32_t sleeps[8];
+	    uint32_t wakes[WAKE_SOURCES];
+	    uint32_t resleeps;
+	    uint32_t check;
+	} sleepStats_t;
+
+	//---------------------------------------------------------
+	// How long each unit has been powered, counted by AVRsleep
+	// once attached, in units of the attached clock. Units are
+	// indexed by powerMode_t bit number: the PRR bits 0 to 7,
+	// where 4 is unused, then the AC, BOD and WDT.
+	//---------------------------------------------------------
+	const uint8_t POWER_UNITS = 11;
+
+	typedef struct powerAccount {
+	    uint32_t onTime[POWER_UNITS];
+	    uint32_t elapsed;
+	} powerAccount_t;
+
+	//---------------------------------------------------------
+	// What each callback costs, counted by AVRsleep once a
+	// profiler is attached: how many calls, how long they took
+	// by the profiler's clock, and the estimated charge, in
+	// mA times clock units. With micros() as the clock, that's
+	// nanocoulombs.
+	//---------------------------------------------------------
+	typedef struct callbackCost {
+	    uint32_t calls;
+	    uint32_t time;
+	    uint32_t charge;
+	} callbackCost_t;
+
+	//---------------------------------------------------------
+	// Where each callback is counted in the profiler's table.
+	// The wake handlers follow on, by wakeSource_t.
+	//---------------------------------------------------------
+	typedef enum costIndex : uint8_t {
+	    COST_PRE_SLEEP = 0,
+	    COST_AFTER_WAKE,
+	    COST_WAKE_FILTER,
+	    COST_WAKE_HANDLER,
+	    COST_ENTRIES = COST_WAKE_HANDLER + WAKE_SOURCES
+	} costIndex_t;
+
+} // End of namespace.
+
+#endif // AVR_SLEEPTYPES_H
@@ -0,0 +1,133 @@
+#include "AVR_stats.h"
+#include <string.h>
+
+namespace sleep {
+
+	static const uint16_t STATS_MAGIC = 0x57A7;
+
+	//-------------------------------------------------------------
+	// The statistics live in .noinit, so the C runtime leaves them
+	// alone over a reset.
+	//-------------------------------------------------------------
+	static persistentStats_t block __attribute__((section(".noinit")));
+
+	//-------------------------------------------------------------
+	// A sleepStats_t is nothing but 32 bit counters, so it can be
+	// summed and added up as an array.
+	//-------------------------------------------------------------
+	static const uint8_t COUNTERS = sizeof(sleepStats_t) / sizeof(uint32_t);
+
+	static_assert(sizeof(sleepStats_t) % sizeof(uint32_t) == 0,
+	              "AVR_stats: sleepStats_t must hold only uint32_t.");
+
+	//-------------------------------------------------------------
+	// The CRC covers the boot count and the totals.
+	//-------------------------------------------------------------
+	static uint16_t totalsCRC() {
+		uint16_t crc = crc16(&block.boots, sizeof(block.boots));
+		return crc16(&block.totals, sizeof(sleepStats_t), crc);
+	}
+
+	//-------------------------------------------------------------
+	// Is the check total the sum of the counts?
+	//-------------------------------------------------------------
+	static bool countsGood(const sleepStats_t &stats) {
+		const uint32_t *counter = (const uint32_t *)&stats;
+		uint32_t sum = 0;
+
+		for (uint8_t i = 0; i < COUNTERS - 1; i++) {
+		    sum += counter[i];
+		}
+
+		return sum == stats.check;
+	}
+
+	//-------------------------------------------------------------
+	// Add one set of counts to another, check total included.
+	//-------------------------------------------------------------
+	static void addCounts(sleepStats_t &to, const sleepStats_t &from) {
+		uint32_t *t = (uint32_t *)&to;
+		const uint32_t *f = (const uint32_t *)&from;
+
+		for (uint8_t i = 0; i < COUNTERS; i++) {
+		    t[i] += f[i];
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Constructor. The block is left alone until begin().
+	//-------------------------------------------------------------
+	AVR_stats::AVR_stats() :
+		wasMerged(false)
+		{}
+
+	//-------------------------------------------------------------
+	// If the block is intact, add the last run's counts to the
+	// totals, otherwise start from scratch. Count this boot, seal
+	// the totals, and have AVRsleep count into the current block.
+	//-------------------------------------------------------------
+	void AVR_stats::begin() {
+		AVRsleep.attachStats(nullptr);
+
+		wasMerged = block.magic == STATS_MAGIC &&
+		            block.crc == totalsCRC() &&
+		            countsGood(block.current);
+
+		if (wasMerged) {
+		    addCounts(block.totals, block.current);
+		} else if (block.magic != STATS_MAGIC || block.crc != totalsCRC()) {
+		    memset(&block, 0, sizeof(persistentStats_t));
+		}
+
+		memset(&block.current, 0, sizeof(sleepStats_t));
+		block.boots++;
+		block.crc = totalsCRC();
+		block.magic = STATS_MAGIC;
+
+		AVRsleep.attachStats(&block.current);
+	}
+
+	void AVR_stats::end() {
+		AVRsleep.attachStats(nullptr);
+	}
+
+	//-------------------------------------------------------------
+	// Copies are taken with interrupts off, in case we're called
+	// from somewhere goToSleep() could interrupt.
+	//-------------------------------------------------------------
+	void AVR_stats::session(sleepStats_t &out) const {
+		uint8_t oldSREG = SREG;
+		cli();
+		out = block.current;
+		SREG = oldSREG;
+	}
+
+	void AVR_stats::lifetime(sleepStats_t &out) const {
+		uint8_t oldSREG = SREG;
+		cli();
+		out = block.totals;
+		addCounts(out, block.current);
+		SREG = oldSREG;
+	}
+
+	uint32_t AVR_stats::boots() const {
+		return block.boots;
+	}
+
+	void AVR_stats::clear() {
+		uint8_t oldSREG = SREG;
+		cli();
+		memset(&block.totals, 0, sizeof(sleepStats_t));
+		memset(&block.current, 0, sizeof(sleepStats_t));
+		block.boots = 1;
+		block.crc = totalsCRC();
+		SREG = oldSREG;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_stats object.
+//-------------------------------------------------------------
+sleep::AVR_stats AVRstats;
+
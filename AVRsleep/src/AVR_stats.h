@@ -0,0 +1,90 @@
+#ifndef AVR_STATS_H
+#define AVR_STATS_H
+
+/*============================================================
+ * The AVR_stats class keeps AVRsleep's statistics in RAM that
+ * the C runtime doesn't clear (the .noinit section), so they
+ * survive a brown out, WDT or external reset. On each boot,
+ * begin() checks the block and adds the last run's counts to
+ * the lifetime totals. Nothing is written to the EEPROM.
+ *
+ * The lifetime totals are checked with a CRC and a magic
+ * number. The current run's counts change on every sleep, so
+ * they are checked against AVRsleep's running check total
+ * instead, which costs one more increment per count.
+ *
+ * A power on, or a lost supply, leaves .noinit full of
+ * rubbish, which won't pass the checks, so everything starts
+ * again from zero.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_crc.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// The block kept over a reset.
+	//---------------------------------------------------------
+	typedef struct persistentStats {
+	    uint16_t magic;
+	    uint16_t crc;
+	    uint32_t boots;
+	    sleepStats_t totals;
+	    sleepStats_t current;
+	} persistentStats_t;
+
+
+	class AVR_stats {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_stats();
+
+		//---------------------------------------------------------
+		// Check and merge the block, and start counting. Call
+		// from setup().
+		//---------------------------------------------------------
+		void begin();
+
+		//---------------------------------------------------------
+		// Stop counting.
+		//---------------------------------------------------------
+		void end();
+
+		//---------------------------------------------------------
+		// Counts since this boot, and since records began.
+		//---------------------------------------------------------
+		void session(sleepStats_t &out) const;
+		void lifetime(sleepStats_t &out) const;
+
+		//---------------------------------------------------------
+		// Boots merged into the totals, including this one.
+		//---------------------------------------------------------
+		uint32_t boots() const;
+
+		//---------------------------------------------------------
+		// Were last run's counts good, and merged?
+		//---------------------------------------------------------
+		bool merged() const { return wasMerged; }
+
+		//---------------------------------------------------------
+		// Start again from zero.
+		//---------------------------------------------------------
+		void clear();
+
+	private:
+		bool wasMerged;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_stats AVRstats;
+
+#endif // AVR_STATS_H
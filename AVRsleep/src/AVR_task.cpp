@@ -0,0 +1,426 @@
+#include "AVR_task.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// The pin change function for pins being waited for. The
+	// interrupt has woken us, which is all we need.
+	//-------------------------------------------------------------
+	static void pinChanged(const uint8_t pcint, const bool level) {
+		(void)pcint;
+		(void)level;
+	}
+
+	//-------------------------------------------------------------
+	// The longest wait, in ticks, that ready() can compare with
+	// the 16 bit tick count.
+	//-------------------------------------------------------------
+	static const uint16_t MAX_TICKS = 0x7FFF;
+
+	//-------------------------------------------------------------
+	// Convert a number of periods at one WDT period into ticks
+	// at another. Each period is twice the one before, so it's a
+	// shift, rounded up when the ticks are longer, so that a
+	// delay is never cut short, and clamped to MAX_TICKS.
+	//-------------------------------------------------------------
+	static uint16_t toTicks(const uint16_t periods, const tickPeriod_t from,
+	                        const tickPeriod_t to) {
+		uint32_t ticks = periods;
+
+		if (from > to) {
+		    ticks <<= (from - to);
+		} else if (from < to) {
+		    uint8_t shift = to - from;
+		    ticks = (ticks + (1UL << shift) - 1) >> shift;
+		}
+
+		return ticks > MAX_TICKS ? MAX_TICKS : ticks;
+	}
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_tasks::AVR_tasks() :
+		tasks(nullptr),
+		adcTask(nullptr),
+		tickPeriod(sleep::TICK_16MS),
+		tickStarted(false)
+		{}
+
+	//-------------------------------------------------------------
+	// Add a task to the front of the list, unless it's already
+	// there, and set it to run from the top.
+	//-------------------------------------------------------------
+	void AVR_tasks::add(task_t &task, const taskFN fn) {
+		task_t *t = tasks;
+		while (t && t != &task) {
+		    t = t->next;
+		}
+
+		if (!t) {
+		    task.next = tasks;
+		    tasks = &task;
+		} else {
+		    uint8_t oldSREG = SREG;
+		    cli();
+		    release(&task);
+		    SREG = oldSREG;
+		}
+
+		task.fn = fn;
+		task.line = 0;
+		task.waitFor = sleep::AWAIT_NONE;
+		task.value = 0;
+	}
+
+	//-------------------------------------------------------------
+	// Wait for a number of periods, of tickPeriod. If AVRtick isn't
+	// running, we start it, and stop it again when nothing is
+	// waiting on a delay. If someone else has it running at
+	// another period, the delay is converted to its ticks.
+	//-------------------------------------------------------------
+	void AVR_tasks::awaitDelay(task_t *task, const uint16_t periods) {
+		if (!AVRtick.running()) {
+		    AVRtick.begin(tickPeriod);
+		    tickStarted = true;
+		}
+
+		task->until = AVRtick.ticks() +
+		    toTicks(periods, tickPeriod, AVRtick.period());
+		task->waitFor = sleep::AWAIT_DELAY;
+	}
+
+	//-------------------------------------------------------------
+	// Another unfinished task waiting for the same pin, if any.
+	//-------------------------------------------------------------
+	task_t *AVR_tasks::pinWaiter(const task_t *task) const {
+		for (task_t *t = tasks; t; t = t->next) {
+		    if (t != task && t->fn && t->waitFor == sleep::AWAIT_PIN &&
+		        t->pcint == task->pcint) {
+		        return t;
+		    }
+		}
+
+		return nullptr;
+	}
+
+	//-------------------------------------------------------------
+	// Wait for a pin to read HIGH or LOW. Whatever function was
+	// attached to the pin is saved, to be put back afterwards. If
+	// another task is already waiting for the pin, its saved
+	// function is the one to keep, not ours.
+	//-------------------------------------------------------------
+	void AVR_tasks::awaitPin(task_t *task, const uint8_t pcint, const bool level) {
+		uint8_t oldSREG = SREG;
+		cli();
+
+		task->pcint = pcint;
+		task->level = level;
+
+		task_t *other = pinWaiter(task);
+		if (other) {
+		    task->pinHandler = other->pinHandler;
+		} else {
+		    task->pinHandler = AVRpcint.attached(pcint);
+		    AVRpcint.attach(pcint, pinChanged);
+		}
+
+		task->waitFor = sleep::AWAIT_PIN;
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Wait for a conversion. There's only one ADC, so if another
+	// task has a conversion running, ready() starts ours when
+	// that one has finished.
+	//-------------------------------------------------------------
+	void AVR_tasks::awaitADC(task_t *task) {
+		uint8_t oldSREG = SREG;
+		cli();
+		task->waitFor = sleep::AWAIT_ADC;
+		startADC(task);
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Start a task's conversion, if the ADC is free. If the ADC
+	// isn't enabled, there's nothing to wait for, and the result
+	// is zero. Returns false if the task must keep waiting.
+	// Called with interrupts disabled.
+	//-------------------------------------------------------------
+	bool AVR_tasks::startADC(task_t *task) {
+		if (adcTask || !sleep::adcReady()) {
+		    return false;
+		}
+
+		if (!(ADCSRA & (1 << ADEN))) {
+		    task->value = 0;
+		    task->waitFor = sleep::AWAIT_NONE;
+		    return true;
+		}
+
+		adcTask = task;
+		sleep::startADC();
+		return false;
+	}
+
+	//-------------------------------------------------------------
+	// Give up whatever a task is waiting for, when it's added
+	// again part way through. The pin function is put back if no
+	// other task is waiting for the pin, and the ADC is freed for
+	// the next task, once the conversion running has finished.
+	// Called with interrupts disabled.
+	//-------------------------------------------------------------
+	void AVR_tasks::release(task_t *task) {
+		switch (task->waitFor) {
+		    case sleep::AWAIT_PIN:
+		        if (!pinWaiter(task)) {
+		            if (task->pinHandler) {
+		                AVRpcint.attach(task->pcint, task->pinHandler);
+		            } else {
+		                AVRpcint.detach(task->pcint);
+		            }
+		        }
+		        break;
+
+		    case sleep::AWAIT_ADC:
+		        if (adcTask == task) {
+		            adcTask = nullptr;
+		        }
+		        break;
+
+		    default:
+		        break;
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Wait for a byte.
+	//-------------------------------------------------------------
+	void AVR_tasks::awaitByte(task_t *task, const byteFN bfn) {
+		task->byteSource = bfn;
+		task->waitFor = sleep::AWAIT_BYTE;
+	}
+
+	//-------------------------------------------------------------
+	// Has a task's wait finished? If so, collect the result, tidy
+	// up, and mark it as waiting for nothing, so that asking again
+	// doesn't read another byte, or another ADC result.
+	//-------------------------------------------------------------
+	bool AVR_tasks::ready(task_t *task) {
+		switch (task->waitFor) {
+		    case sleep::AWAIT_NONE:
+		        return true;
+
+		    case sleep::AWAIT_DELAY:
+		        if ((int16_t)(AVRtick.ticks() - task->until) < 0) {
+		            return false;
+		        }
+		        break;
+
+		    case sleep::AWAIT_PIN:
+		        if (AVRpcint.level(task->pcint) != task->level) {
+		            return false;
+		        }
+		        release(task);
+		        break;
+
+		    case sleep::AWAIT_ADC:
+		        if (adcTask != task) {
+		            return startADC(task);
+		        }
+		        if (!sleep::adcReady()) {
+		            return false;
+		        }
+		        task->value = ADC;
+		        adcTask = nullptr;
+		        break;
+
+		    case sleep::AWAIT_BYTE: {
+		        int c = task->byteSource();
+		        if (c < 0) {
+		            return false;
+		        }
+		        task->value = c;
+		        break;
+		    }
+		}
+
+		task->waitFor = sleep::AWAIT_NONE;
+		return true;
+	}
+
+	//-------------------------------------------------------------
+	// Run every task that is ready. Finished tasks have their
+	// function cleared, and are skipped. Each run is costed, if
+	// AVRsleep is profiling and AVR_TASK_COSTS is set.
+	//-------------------------------------------------------------
+	uint8_t AVR_tasks::runReady() {
+		uint8_t running = 0;
+
+		for (task_t *t = tasks; t; t = t->next) {
+		    if (!t->fn) {
+		        continue;
+		    }
+
+		    uint8_t oldSREG = SREG;
+		    cli();
+		    bool go = ready(t);
+		    SREG = oldSREG;
+
+		    if (!go) {
+		        running++;
+		        continue;
+		    }
+
+		#if AVR_TASK_COSTS
+		    uint32_t started = AVRsleep.costStart();
+		    uint8_t startPRR = PRR;
+		    taskResult_t result = t->fn(t);
+		    AVRsleep.addCost(t->cost, started, startPRR);
+		#else
+		    taskResult_t result = t->fn(t);
+		#endif
+
+		    if (result == sleep::TASK_DONE) {
+		        t->fn = nullptr;
+		        continue;
+		    }
+
+		    running++;
+		}
+
+		return running;
+	}
+
+	//-------------------------------------------------------------
+	// The same insertion as AVR_sleep::topCosts(), over the list.
+	//-------------------------------------------------------------
+	uint8_t AVR_tasks::topTasks(task_t **top, const uint8_t count) const {
+		uint8_t found = 0;
+
+	#if AVR_TASK_COSTS
+
+		for (task_t *t = tasks; t; t = t->next) {
+		    if (!t->cost.calls) {
+		        continue;
+		    }
+
+		    uint8_t slot = found < count ? found++ : count;
+		    while (slot && top[slot - 1]->cost.charge < t->cost.charge) {
+		        if (slot < count) {
+		            top[slot] = top[slot - 1];
+		        }
+		        slot--;
+		    }
+
+		    if (slot < count) {
+		        top[slot] = t;
+		    }
+		}
+	#else
+		(void)top;
+		(void)count;
+	#endif
+
+		return found;
+	}
+
+	//-------------------------------------------------------------
+	// Work out the deepest sleep mode that every waiting task can
+	// be woken from, and sleep in it until one of them is ready.
+	// Peripherals are powered off as they would be by goToSleep(),
+	// except the USART or ADC if a task is waiting on them.
+	//-------------------------------------------------------------
+	void AVR_tasks::sleepUntilReady() {
+		sleepMode_t mode = sleep::SM_POWER_DOWN;
+		uint8_t needed = 0;
+		bool delays = false;
+
+		for (task_t *t = tasks; t; t = t->next) {
+		    if (!t->fn) {
+		        continue;
+		    }
+
+		    switch (t->waitFor) {
+		        case sleep::AWAIT_NONE:
+		            return;
+
+		        case sleep::AWAIT_BYTE:
+		            mode = sleep::SM_IDLE;
+		            needed |= (1 << PRUSART0);
+		            break;
+
+		        case sleep::AWAIT_ADC:
+		            if (mode != sleep::SM_IDLE) {
+		                mode = sleep::SM_ADC;
+		            }
+		            needed |= (1 << PRADC);
+		            break;
+
+		        case sleep::AWAIT_DELAY:
+		            delays = true;
+		            break;
+
+		        case sleep::AWAIT_PIN:
+		            break;
+		    }
+		}
+
+		if (AVRsleep.isLocked()) {
+		    mode = sleep::SM_IDLE;
+		}
+
+		if (!delays && tickStarted) {
+		    AVRtick.end();
+		    tickStarted = false;
+		}
+
+		if (mode != sleep::SM_IDLE) {
+		    AVRsleep.drainUSART();
+		}
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		uint8_t oldPRR = PRR;
+		AVRsleep.writePRR(oldPRR | (AVRsleep.sleepPRR() & ~needed));
+
+		for (;;) {
+		    task_t *t = tasks;
+		    while (t && !(t->fn && ready(t))) {
+		        t = t->next;
+		    }
+
+		    if (t) {
+		        break;
+		    }
+
+		    AVRsleep.nap(mode);
+		}
+
+		AVRsleep.writePRR(oldPRR);
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// Run until every task has finished.
+	//-------------------------------------------------------------
+	void AVR_tasks::run() {
+		while (runReady()) {
+		    sleepUntilReady();
+		}
+
+		if (tickStarted) {
+		    AVRtick.end();
+		    tickStarted = false;
+		}
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_tasks object.
+//-------------------------------------------------------------
+sleep::AVR_tasks AVRtasks;
+
@@ -0,0 +1,227 @@
+#ifndef AVR_TASK_H
+#define AVR_TASK_H
+
+/*============================================================
+ * Stackless coroutines, or "protothreads", that sleep between
+ * awaits. A task is an ordinary function which is run from the
+ * top each time, with a switch statement, hidden in the macros
+ * below, jumping back to where it last waited. There's no stack
+ * per task, so local variables do NOT survive an await. Keep
+ * anything that must in a static, or in a struct that embeds
+ * the task_t.
+ *
+ * A task can wait for a delay, a pin level, an ADC conversion
+ * or a serial byte. When no task can run, the runner sleeps in
+ * the deepest mode that will still wake it for everything that
+ * is being waited for:
+ *
+ *  Serial byte    - SM_IDLE, the USART needs its clock.
+ *  ADC conversion - SM_ADC.
+ *  Delay, pin     - SM_POWER_DOWN, woken by the WDT or a PCINT.
+ *
+ * Uses AVR_tick, AVR_pcint and AVR_await, so the restrictions
+ * on their interrupt handlers apply here too. A pin that is
+ * being waited for has its AVRpcint function replaced until
+ * the last wait for it is over, when the old one is put back.
+ * Tasks waiting for the ADC take turns, one conversion each.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_tick.h"
+#include "AVR_pcint.h"
+#include "AVR_await.h"
+
+//-------------------------------------------------------------
+// Set to 1 to cost each task while AVRsleep has a profiler
+// attached. It adds a callbackCost_t, 12 bytes, to each task.
+//-------------------------------------------------------------
+#ifndef AVR_TASK_COSTS
+#define AVR_TASK_COSTS 0
+#endif
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// What a task returns to the runner.
+	//---------------------------------------------------------
+	typedef enum taskResult : uint8_t {
+	    TASK_WAITING = 0,
+	    TASK_DONE
+	} taskResult_t;
+
+	//---------------------------------------------------------
+	// What a task is waiting for.
+	//---------------------------------------------------------
+	typedef enum awaitType : uint8_t {
+	    AWAIT_NONE = 0,
+	    AWAIT_DELAY,
+	    AWAIT_PIN,
+	    AWAIT_ADC,
+	    AWAIT_BYTE
+	} awaitType_t;
+
+	//---------------------------------------------------------
+	// Returns a byte, or -1 if there isn't one. Called with
+	// interrupts disabled. The same as AVR_console's readFN.
+	//---------------------------------------------------------
+	typedef int (*byteFN)();
+
+	struct task;
+	typedef taskResult_t (*taskFN)(struct task *task);
+
+	//---------------------------------------------------------
+	// One task. Only the macros below should touch this.
+	//---------------------------------------------------------
+	typedef struct task {
+	    struct task *next;
+	    taskFN fn;
+	    uint16_t line;
+	    awaitType_t waitFor;
+	    uint8_t pcint;
+	    bool level;
+	    pinChangeFN pinHandler;
+	    uint16_t until;
+	    byteFN byteSource;
+	    int16_t value;
+	#if AVR_TASK_COSTS
+	    callbackCost_t cost;
+	#endif
+	} task_t;
+
+
+	class AVR_tasks {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_tasks();
+
+		//---------------------------------------------------------
+		// Add a task. It runs, from the top, on the next round.
+		//---------------------------------------------------------
+		void add(task_t &task, const taskFN fn);
+
+		//---------------------------------------------------------
+		// Run each task that is ready, once. Returns the number
+		// of tasks still to finish.
+		//---------------------------------------------------------
+		uint8_t runReady();
+
+		//---------------------------------------------------------
+		// Run tasks, sleeping whenever none is ready, until they
+		// have all finished.
+		//---------------------------------------------------------
+		void run();
+
+		//---------------------------------------------------------
+		// The period delays are given in. Default TICK_16MS.
+		//---------------------------------------------------------
+		void setTickPeriod(const tickPeriod_t period) { tickPeriod = period; }
+
+		//---------------------------------------------------------
+		// The costliest tasks, by charge, most first, while
+		// AVRsleep has a profiler attached. Returns how many
+		// there are, which is none without AVR_TASK_COSTS.
+		//---------------------------------------------------------
+		uint8_t topTasks(task_t **top, const uint8_t count) const;
+
+		//---------------------------------------------------------
+		// Used by the macros.
+		//---------------------------------------------------------
+		void awaitDelay(task_t *task, const uint16_t periods);
+		void awaitPin(task_t *task, const uint8_t pcint, const bool level);
+		void awaitADC(task_t *task);
+		void awaitByte(task_t *task, const byteFN bfn);
+
+	private:
+		//---------------------------------------------------------
+		// Can a task run? Called with interrupts disabled.
+		//---------------------------------------------------------
+		bool ready(task_t *task);
+
+		//---------------------------------------------------------
+		// Helpers for the pin and ADC waits.
+		//---------------------------------------------------------
+		task_t *pinWaiter(const task_t *task) const;
+		bool startADC(task_t *task);
+		void release(task_t *task);
+
+		//---------------------------------------------------------
+		// Sleep as deeply as the waiting tasks allow.
+		//---------------------------------------------------------
+		void sleepUntilReady();
+
+		//---------------------------------------------------------
+		// The tasks, as a list.
+		//---------------------------------------------------------
+		task_t *tasks;
+
+		//---------------------------------------------------------
+		// The task whose conversion the ADC is doing, if any.
+		//---------------------------------------------------------
+		task_t *adcTask;
+
+		//---------------------------------------------------------
+		// WDT period for delays, and did we start AVRtick?
+		//---------------------------------------------------------
+		tickPeriod_t tickPeriod;
+		bool tickStarted;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_tasks AVRtasks;
+
+
+//-------------------------------------------------------------
+// The task macros. Each task function looks like this:
+//
+//  sleep::taskResult_t blink(sleep::task_t *t) {
+//      TASK_BEGIN(t);
+//      for (;;) {
+//          PINB = (1 << PINB5);
+//          TASK_AWAIT_DELAY(t, 31);
+//      }
+//      TASK_END(t);
+//  }
+//
+// Don't put an await inside a switch statement of your own.
+//-------------------------------------------------------------
+#define TASK_BEGIN(t) switch ((t)->line) { case 0:
+
+#define TASK_END(t) } (t)->line = 0; return sleep::TASK_DONE
+
+#define TASK_WAIT(t) \
+	do { \
+	    (t)->line = __LINE__; \
+	    return sleep::TASK_WAITING; \
+	    case __LINE__:; \
+	} while (0)
+
+// Let the other tasks run.
+#define TASK_YIELD(t) TASK_WAIT(t)
+
+// Wait for a number of tick periods.
+#define TASK_AWAIT_DELAY(t, periods) \
+	do { AVRtasks.awaitDelay((t), (periods)); TASK_WAIT(t); } while (0)
+
+// Wait for a pin, by PCINT number, to read HIGH or LOW.
+#define TASK_AWAIT_PIN(t, pcint, level) \
+	do { AVRtasks.awaitPin((t), (pcint), (level)); TASK_WAIT(t); } while (0)
+
+// Start a conversion and wait for it. The result is in TASK_VALUE.
+#define TASK_AWAIT_ADC(t) \
+	do { AVRtasks.awaitADC(t); TASK_WAIT(t); } while (0)
+
+// Wait for a byte from a byteFN. The byte is in TASK_VALUE.
+#define TASK_AWAIT_BYTE(t, bfn) \
+	do { AVRtasks.awaitByte((t), (bfn)); TASK_WAIT(t); } while (0)
+
+#define TASK_VALUE(t) ((t)->value)
+
+#endif // AVR_TASK_H
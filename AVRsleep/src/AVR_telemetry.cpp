@@ -0,0 +1,65 @@
+#include "AVR_telemetry.h"
+#include <string.h>
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Frames are numbered, so the host can spot lost ones.
+	//-------------------------------------------------------------
+	static uint8_t telemetrySeq = 0;
+
+	//-------------------------------------------------------------
+	// The counts are copied with interrupts off, as goToSleep()
+	// could be interrupted, and so could we.
+	//-------------------------------------------------------------
+	void buildTelemetry(telemetryFrame_t &frame) {
+		memset(&frame, 0, sizeof(telemetryFrame_t));
+
+		frame.sync = TELEMETRY_SYNC;
+		frame.version = TELEMETRY_VERSION;
+		frame.seq = telemetrySeq++;
+		frame.modeFlags = AVRsleep.sleepMode() >> 1;
+		frame.powerBits = AVRsleep.powerMode();
+		frame.wokenBy = AVRsleep.wokenBy();
+		frame.clock = AVRsleep.now();
+		frame.lastSleep = AVRsleep.lastSleep();
+
+		if (AVRsleep.isLocked()) {
+		    frame.modeFlags |= TELEMETRY_LOCKED;
+		}
+
+		if (!frame.clock) {
+		    frame.modeFlags |= TELEMETRY_NO_CLOCK;
+		}
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		const sleepStats_t *stats = AVRsleep.statistics();
+		if (stats) {
+		    for (uint8_t mode = 0; mode < 8; mode++) {
+		        frame.sleeps[mode] = stats->sleeps[mode];
+		    }
+
+		    for (uint8_t source = 0; source < WAKE_SOURCES; source++) {
+		        frame.wakes[source] = stats->wakes[source];
+		    }
+
+		    frame.resleeps = stats->resleeps;
+		} else {
+		    frame.modeFlags |= TELEMETRY_NO_STATS;
+		}
+
+		SREG = oldSREG;
+
+		frame.crc = telemetryCRC(frame);
+	}
+
+	bool sendTelemetry() {
+		telemetryFrame_t frame;
+
+		buildTelemetry(frame);
+		return AVRtxBatch.add(&frame, sizeof(telemetryFrame_t));
+	}
+
+} // End of namespace.
@@ -0,0 +1,37 @@
+#ifndef AVR_TELEMETRY_H
+#define AVR_TELEMETRY_H
+
+/*============================================================
+ * Binary telemetry frames. A frame holds AVRsleep's settings,
+ * the last sleep, and the counts from the attached statistics
+ * block, in 64 bytes with a CRC. That's a fraction of the time
+ * the USART, and the CPU, would be kept awake printing the
+ * same as text. See AVR_telemetryFormat.h for the layout, and
+ * extras/tools/avrtelemetry for a decoder.
+ *
+ * Frames are sent through AVRtxBatch, which must be started
+ * with begin() first, so the USART is only powered while
+ * the batch is being sent.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_txBatch.h"
+#include "AVR_telemetryFormat.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Fill in a frame, CRC and all.
+	//---------------------------------------------------------
+	void buildTelemetry(telemetryFrame_t &frame);
+
+	//---------------------------------------------------------
+	// Build a frame and add it to AVRtxBatch. Returns false if
+	// AVR_TXBATCH_SIZE is too small to hold it.
+	//---------------------------------------------------------
+	bool sendTelemetry();
+
+} // End of namespace.
+
+#endif // AVR_TELEMETRY_H
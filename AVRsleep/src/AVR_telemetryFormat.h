@@ -0,0 +1,93 @@
+#ifndef AVR_TELEMETRYFORMAT_H
+#define AVR_TELEMETRYFORMAT_H
+
+/*============================================================
+ * The format of AVR_telemetry's binary frames. This header has
+ * no AVR dependencies, so the host tools in extras/tools use
+ * it to decode them.
+ *
+ * A frame is 64 bytes, little endian, with every field on its
+ * natural boundary, so it has the same layout on the AVR and
+ * on a PC, without packing:
+ *
+ *  sync       - TELEMETRY_SYNC, to find the start of a frame.
+ *  version    - TELEMETRY_VERSION.
+ *  seq        - Counts up by one per frame, to spot gaps.
+ *  modeFlags  - The sleep mode set, as SMCR bits SM2:0, in
+ *               bits 2:0, and the TELEMETRY_ flags.
+ *  powerBits  - The powerMode_t set with setSleepMode().
+ *  wokenBy    - The wake up sources of the last sleep.
+ *  clock      - AVRsleep.now(), or zero without a clock.
+ *  lastSleep  - The length of the last sleep, by the clock.
+ *  sleeps     - Sleeps by SMCR bits SM2:0.
+ *  wakes      - Wakes by wakeSource_t.
+ *  resleeps   - Wakes sent back to sleep by the wake filter.
+ *  crc        - CRC-16/CCITT-FALSE of everything before it.
+ *
+ * There is no histogram of sleep lengths, as AVRsleep only
+ * counts them. AVR_trace records the length of each sleep.
+ *
+ * The counts are the low 16 bits of the sleepStats_t counters,
+ * so they wrap. The host works out what happened between two
+ * frames by subtracting, modulo 65,536, which is right as long
+ * as fewer than 65,536 of anything happen between frames.
+ *===========================================================*/
+
+#include <stdint.h>
+#include "AVR_sleepTypes.h"
+#include "AVR_crc.h"
+
+
+namespace sleep {
+
+	typedef struct telemetryFrame {
+	    uint8_t sync;
+	    uint8_t version;
+	    uint8_t seq;
+	    uint8_t modeFlags;
+	    uint16_t powerBits;
+	    uint16_t wokenBy;
+	    uint32_t clock;
+	    uint32_t lastSleep;
+	    uint16_t sleeps[8];
+	    uint16_t wakes[WAKE_SOURCES];
+	    uint16_t resleeps;
+	    uint16_t crc;
+	} telemetryFrame_t;
+
+	static_assert(sizeof(telemetryFrame_t) == 64,
+	              "AVR_telemetryFormat: telemetryFrame_t must be 64 bytes.");
+
+	const uint8_t TELEMETRY_SYNC = 0xA5;
+	const uint8_t TELEMETRY_VERSION = 1;
+
+	//---------------------------------------------------------
+	// Flags in modeFlags.
+	//---------------------------------------------------------
+	const uint8_t TELEMETRY_LOCKED = 0x08;      // A lock was held
+	const uint8_t TELEMETRY_NO_STATS = 0x10;    // Counts are all zero
+	const uint8_t TELEMETRY_NO_CLOCK = 0x20;    // Times are all zero
+
+	//---------------------------------------------------------
+	// The CRC, and whether a frame is good.
+	//---------------------------------------------------------
+	inline uint16_t telemetryCRC(const telemetryFrame_t &frame) {
+		return crc16(&frame, sizeof(telemetryFrame_t) - sizeof(frame.crc));
+	}
+
+	inline bool telemetryValid(const telemetryFrame_t &frame) {
+		return frame.sync == TELEMETRY_SYNC &&
+		       frame.version == TELEMETRY_VERSION &&
+		       frame.crc == telemetryCRC(frame);
+	}
+
+	//---------------------------------------------------------
+	// Unpacking.
+	//---------------------------------------------------------
+	inline uint8_t telemetryMode(const telemetryFrame_t &frame) {
+		return frame.modeFlags & 0x07;
+	}
+
+} // End of namespace.
+
+#endif // AVR_TELEMETRYFORMAT_H
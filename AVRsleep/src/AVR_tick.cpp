@@ -0,0 +1,172 @@
+#include "AVR_tick.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Constructor. Nothing is ticking yet.
+	//-------------------------------------------------------------
+	AVR_tick::AVR_tick() :
+		count(0),
+		copyWDTCSR(0),
+		tickPeriod(sleep::TICK_16MS),
+		isRunning(false)
+		{}
+
+	//-------------------------------------------------------------
+	// Changing the WDT prescaler or mode needs the WDCE bit set
+	// and the new value written within 4 clock cycles. Interrupts
+	// must be off while we do it. The WDT may have been turned on
+	// or off, so the power account is brought up to date.
+	//-------------------------------------------------------------
+	void AVR_tick::writeWDTCSR(const uint8_t value) {
+		uint8_t oldSREG = SREG;
+		cli();
+
+		wdt_reset();
+		WDTCSR = (1 << WDCE) | (1 << WDE);
+		WDTCSR = value;
+
+		AVRsleep.accountPower();
+		SREG = oldSREG;
+	}
+
+	//-------------------------------------------------------------
+	// The WDTCSR bits for interrupt mode at a period. WDP3 is not
+	// next to WDP2:0.
+	//-------------------------------------------------------------
+	uint8_t AVR_tick::periodBits(const tickPeriod_t period) {
+		return (1 << WDIE) |
+		       (period & 0x07) |
+		       ((period & 0x08) ? (1 << WDP3) : 0);
+	}
+
+	//-------------------------------------------------------------
+	// Start the WDT in interrupt mode, no reset. The settings in
+	// force beforehand are saved, so that end() can put them
+	// back. Calling begin() while running just changes the period,
+	// and the count carries on, as others may be counting with it.
+	//-------------------------------------------------------------
+	void AVR_tick::begin(const tickPeriod_t period) {
+		if (!isRunning) {
+		    copyWDTCSR = WDTCSR & ((1 << WDIE) | (1 << WDE) |
+		                           (1 << WDP3) | (1 << WDP2) |
+		                           (1 << WDP1) | (1 << WDP0));
+		    count = 0;
+		}
+
+		//---------------------------------------------------------
+		// WDRF overrides WDE, so clear it first or we can't get
+		// into interrupt only mode.
+		//---------------------------------------------------------
+		MCUSR &= ~(1 << WDRF);
+
+		tickPeriod = period;
+		isRunning = true;
+
+		writeWDTCSR(periodBits(period));
+	}
+
+	//-------------------------------------------------------------
+	// Stop ticking and put the WDT back as it was.
+	//-------------------------------------------------------------
+	void AVR_tick::end() {
+		if (!isRunning) {
+		    return;
+		}
+
+		writeWDTCSR(copyWDTCSR);
+		isRunning = false;
+	}
+
+	//-------------------------------------------------------------
+	// The count is 16 bits, so read it with interrupts off.
+	//-------------------------------------------------------------
+	uint16_t AVR_tick::ticks() const {
+		uint8_t oldSREG = SREG;
+		cli();
+		uint16_t result = count;
+		SREG = oldSREG;
+		return result;
+	}
+
+	//-------------------------------------------------------------
+	// Sleep for a number of WDT periods. If we are not already
+	// ticking, the WDT is started for the duration, and put back
+	// afterwards.
+	//
+	// If we are ticking, at the same period or a shorter one, we
+	// count the equivalent number of our periods. If we are
+	// ticking more slowly than asked, the WDT is switched to the
+	// period asked for while we sleep, then switched back, with
+	// the count moved on by the whole periods slept. Either way,
+	// the WDT is reset first, so that the first period is a full
+	// one.
+	//
+	// Any other interrupt will wake us, but we go straight back
+	// to sleep again until enough periods have passed. PRR and
+	// the attached functions are not used, this is a bare sleep.
+	//-------------------------------------------------------------
+	void AVR_tick::sleep(
+		    const uint8_t periods,
+		    const tickPeriod_t period,
+		    const sleepMode_t sleepMode) {
+
+		bool started = !isRunning;
+		if (started) {
+		    begin(period);
+		}
+
+		uint8_t oldSREG = SREG;
+		cli();
+
+		bool switched = period < tickPeriod;
+		uint8_t shift = switched ? tickPeriod - period : period - tickPeriod;
+		uint16_t start = count;
+		uint32_t wanted = periods;
+
+		if (switched) {
+		    writeWDTCSR(periodBits(period));
+		} else {
+		    wanted <<= shift;
+		    wdt_reset();
+		}
+
+		//---------------------------------------------------------
+		// At 16 mS, 255 x 8 S is more than 16 bits of ticks.
+		//---------------------------------------------------------
+		uint32_t elapsed = 0;
+		uint16_t last = start;
+		while (elapsed < wanted) {
+		    AVRsleep.nap(sleepMode);
+		    uint16_t now = count;
+		    elapsed += (uint16_t)(now - last);
+		    last = now;
+		}
+
+		if (switched) {
+		    count = start + (uint16_t)(elapsed >> shift);
+		    writeWDTCSR(periodBits(tickPeriod));
+		}
+
+		SREG = oldSREG;
+
+		if (started) {
+		    end();
+		}
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// The WDT interrupt handler. Just counts.
+//-------------------------------------------------------------
+ISR(WDT_vect) {
+	AVRsleep.recordWake(sleep::WAKE_WDT);
+	AVRtick.tick();
+}
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_tick object.
+//-------------------------------------------------------------
+sleep::AVR_tick AVRtick;
+
@@ -0,0 +1,121 @@
+#ifndef AVR_TICK_H
+#define AVR_TICK_H
+
+/*============================================================
+ * The AVR_tick class runs the Watchdog Timer in interrupt
+ * mode to give the other parts of the AVR_sleep library a
+ * wake up source that keeps running in power down. It can
+ * tick away in the background, counting periods, or it can
+ * be used to sleep for a number of periods.
+ *
+ * This class owns the WDT_vect interrupt handler, so it can
+ * not be used in the same sketch as the AVR_wdt library.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Typedef for the WDT periods. These are the values from
+	// the avr/wdt header. The WDT runs from its own 128 KHz
+	// oscillator, so these are approximate.
+	//---------------------------------------------------------
+	typedef enum tickPeriod : uint8_t {
+	    TICK_16MS = WDTO_15MS,
+	    TICK_32MS = WDTO_30MS,
+	    TICK_64MS = WDTO_60MS,
+	    TICK_125MS = WDTO_120MS,
+	    TICK_250MS = WDTO_250MS,
+	    TICK_500MS = WDTO_500MS,
+	    TICK_1S = WDTO_1S,
+	    TICK_2S = WDTO_2S,
+	    TICK_4S = WDTO_4S,
+	    TICK_8S = WDTO_8S
+	} tickPeriod_t;
+
+
+	class AVR_tick {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_tick();
+
+		//---------------------------------------------------------
+		// Start/stop ticking in the background.
+		//---------------------------------------------------------
+		void begin(const tickPeriod_t period = sleep::TICK_16MS);
+		void end();
+
+		//---------------------------------------------------------
+		// Is the WDT ticking for us?
+		//---------------------------------------------------------
+		bool running() const { return isRunning; }
+
+		//---------------------------------------------------------
+		// The period we are ticking at, if we are.
+		//---------------------------------------------------------
+		tickPeriod_t period() const { return tickPeriod; }
+
+		//---------------------------------------------------------
+		// How many periods since begin()? This wraps around.
+		//---------------------------------------------------------
+		uint16_t ticks() const;
+
+		//---------------------------------------------------------
+		// Sleep for a number of WDT periods.
+		//---------------------------------------------------------
+		void sleep(
+		        const uint8_t periods,
+		        const tickPeriod_t period = sleep::TICK_16MS,
+		        const sleepMode_t sleepMode = sleep::SM_POWER_DOWN);
+
+		//---------------------------------------------------------
+		// Called from the WDT interrupt handler only.
+		//---------------------------------------------------------
+		void tick() { count++; }
+
+	private:
+		//---------------------------------------------------------
+		// Write a new value to WDTCSR with the timed sequence.
+		//---------------------------------------------------------
+		static void writeWDTCSR(const uint8_t value);
+
+		//---------------------------------------------------------
+		// The WDTCSR value for interrupt mode at a period.
+		//---------------------------------------------------------
+		static uint8_t periodBits(const tickPeriod_t period);
+
+		//---------------------------------------------------------
+		// Number of periods counted by the interrupt handler.
+		//---------------------------------------------------------
+		volatile uint16_t count;
+
+		//---------------------------------------------------------
+		// The WDT settings in force before begin(). Restored by
+		// end().
+		//---------------------------------------------------------
+		uint8_t copyWDTCSR;
+
+		//---------------------------------------------------------
+		// The period we are ticking at.
+		//---------------------------------------------------------
+		tickPeriod_t tickPeriod;
+
+		//---------------------------------------------------------
+		// Are we ticking?
+		//---------------------------------------------------------
+		bool isRunning;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_tick AVRtick;
+
+#endif // AVR_TICK_H
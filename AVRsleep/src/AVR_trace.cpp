@@ -0,0 +1,230 @@
+#include "AVR_trace.h"
+#include <avr/eeprom.h>
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// The AVRsleep trace function.
+	//-------------------------------------------------------------
+	static void traceSleep(const uint8_t sleepMode,
+	                       const uint16_t wokenBy,
+	                       const uint32_t length) {
+		AVRtrace.record(sleepMode, wokenBy, length);
+	}
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_trace::AVR_trace() :
+		base(0),
+		size(0),
+		next(0),
+		seq(0),
+		batches(),
+		current(0),
+		fill(0),
+		tickets(),
+		vccEvery(0),
+		vccCount(0),
+		lastVcc(0),
+		sampleEvery(1),
+		sampleCount(0),
+		wokeAt(0),
+		woken(false)
+		{}
+
+	//-------------------------------------------------------------
+	// Find our place in the ring. The next slot to write is the
+	// first blank one, or the first whose sequence number doesn't
+	// follow on from the one before. If there's neither, the ring
+	// has been filled exactly once and we start again at slot 0.
+	//-------------------------------------------------------------
+	void AVR_trace::begin(
+		    const uint16_t address,
+		    const uint8_t records,
+		    const uint8_t vccInterval,
+		    const uint8_t sampleInterval) {
+
+		base = address;
+		size = records > sleep::TRACE_MAX_RECORDS ? sleep::TRACE_MAX_RECORDS : records;
+		vccEvery = vccInterval;
+		vccCount = 0;
+		sampleEvery = sampleInterval ? sampleInterval : 1;
+		sampleCount = 0;
+		current = 0;
+		fill = 0;
+		tickets[0] = tickets[1] = 0;
+
+		next = 0;
+		seq = 0;
+		woken = false;
+
+		uint8_t previous = sleep::TRACE_SEQ_BLANK;
+		for (uint8_t slot = 0; slot < size; slot++) {
+		    uint8_t s = eeprom_read_byte((const uint8_t *)(base + slot * sizeof(traceRecord_t)));
+
+		    if (s == sleep::TRACE_SEQ_BLANK ||
+		        (slot && s != traceNextSeq(previous))) {
+		        next = slot;
+		        seq = slot ? traceNextSeq(previous) : 0;
+		        break;
+		    }
+
+		    previous = s;
+		    if (slot == size - 1) {
+		        next = 0;
+		        seq = traceNextSeq(s);
+		    }
+		}
+
+		AVRsleep.attachTrace(traceSleep);
+	}
+
+	void AVR_trace::end() {
+		AVRsleep.attachTrace(nullptr);
+		flush();
+		AVReeQueue.wait();
+	}
+
+	//-------------------------------------------------------------
+	// Build a record and add it to the batch, writing the batch
+	// when it's full.
+	//
+	// Our own writes wake us with EE_READY, byte by byte. If
+	// those sleeps were recorded, each batch would make the next
+	// one, and the EEPROM would be worn out in days. So a sleep
+	// woken by EE_READY alone is never recorded, and of the rest,
+	// only one in every sampleEvery.
+	//-------------------------------------------------------------
+	void AVR_trace::record(
+		    const uint8_t sleepMode,
+		    const uint16_t wokenBy,
+		    const uint32_t length) {
+
+		if (!size) {
+		    return;
+		}
+
+		//---------------------------------------------------------
+		// We're called straight after each wake, so the time
+		// since the last call, less this sleep, is the time we
+		// were awake before it. That's kept up to date for the
+		// sleeps we don't record too.
+		//---------------------------------------------------------
+		uint32_t now = AVRsleep.now();
+		uint32_t awake = 0;
+		if (woken) {
+		    uint32_t elapsed = now - wokeAt;
+		    awake = elapsed > length ? elapsed - length : 0;
+		}
+		wokeAt = now;
+		woken = true;
+
+		if (wokenBy == (1 << sleep::WAKE_EEPROM)) {
+		    return;
+		}
+
+		if (sampleCount) {
+		    sampleCount--;
+		    return;
+		}
+		sampleCount = sampleEvery - 1;
+
+		traceRecord_t &r = batches[current][fill];
+
+		r.seq = seq;
+		r.modeBucket = ((sleepMode >> 1) << 5) | traceBucket(length);
+
+		uint8_t source = sleep::TRACE_NO_SOURCE;
+		for (uint8_t s = 0; s < sleep::WAKE_SOURCES; s++) {
+		    if (wokenBy & (1 << s)) {
+		        source = s;
+		        break;
+		    }
+		}
+
+		r.sourceAwake = (traceBucket(awake, 15) << 4) | source;
+
+		if (vccEvery && !vccCount--) {
+		    lastVcc = traceEncodeVcc(readVcc());
+		    vccCount = vccEvery - 1;
+		}
+		r.vcc = lastVcc;
+
+		seq = traceNextSeq(seq);
+
+		if (++fill == AVR_TRACE_BATCH) {
+		    flush();
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Queue the batch for writing, in two parts if it goes past
+	// the end of the ring, and swap to the other batch. That one
+	// may still be being written, so wait for it.
+	//-------------------------------------------------------------
+	void AVR_trace::flush() {
+		if (!fill) {
+		    return;
+		}
+
+		traceRecord_t *batch = batches[current];
+		uint8_t first = size - next;
+		if (first > fill) {
+		    first = fill;
+		}
+
+		tickets[current] = AVReeQueue.submit(
+		        base + next * sizeof(traceRecord_t),
+		        batch,
+		        first * sizeof(traceRecord_t));
+
+		if (fill > first) {
+		    tickets[current] = AVReeQueue.submit(
+		            base,
+		            batch + first,
+		            (fill - first) * sizeof(traceRecord_t));
+		}
+
+		next = (next + fill) % size;
+		fill = 0;
+		current ^= 1;
+
+		if (tickets[current]) {
+		    AVReeQueue.wait(tickets[current]);
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Measure the band gap against AVcc, and work out AVcc from
+	// it. The first conversions after changing the reference are
+	// thrown away. The ADC is put back as it was.
+	//-------------------------------------------------------------
+	uint16_t AVR_trace::readVcc() {
+		uint8_t oldPRR = PRR;
+		AVRsleep.writePRR(PRR & ~(1 << PRADC));
+
+		uint8_t oldADCSRA = ADCSRA;
+		uint8_t oldADMUX = ADMUX;
+
+		ADCSRA = (1 << ADEN) | (1 << ADPS2) | (1 << ADPS1) | (1 << ADPS0);
+		ADMUX = (1 << REFS0) | 0x0E;
+
+		sleep::awaitADC();
+		sleep::awaitADC();
+		uint16_t adc = sleep::awaitADC();
+
+		ADMUX = oldADMUX;
+		ADCSRA = oldADCSRA & ~(1 << ADSC);
+		AVRsleep.writePRR(oldPRR);
+
+		return adc ? (1100UL * 1024) / adc : 0;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_trace object.
+//-------------------------------------------------------------
+sleep::AVR_trace AVRtrace;
+
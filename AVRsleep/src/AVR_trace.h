@@ -0,0 +1,140 @@
+#ifndef AVR_TRACE_H
+#define AVR_TRACE_H
+
+/*============================================================
+ * The AVR_trace class logs a compact record of every sleep to
+ * a ring in the EEPROM: the sleep mode, how long it lasted, as
+ * a power of two bucket, how long the board was awake before
+ * it, what woke the board, and the supply voltage. Records are
+ * gathered in RAM and written in batches through AVReeQueue,
+ * so the board sleeps, in idle, while the bytes are written.
+ *
+ * The ring is wear levelled: each record goes in the next slot
+ * around, so every byte is written once per trip round the
+ * ring. The write position is found again after a reset from
+ * the sequence numbers in the records. See AVR_traceFormat.h,
+ * which the host tools use to decode an EEPROM dump.
+ *
+ * Sleeps woken only by the EEPROM ready interrupt, which is
+ * what our own writes cause, are not recorded, or the trace
+ * would feed itself. Only one sleep in every "sampleEvery" of
+ * the rest is recorded, to spare the EEPROM.
+ *
+ * Durations come from the clock attached to AVRsleep with
+ * attachClock(). Without one, they are all zero.
+ *
+ * Uses AVR_eeQueue and AVR_await, and so the EE_READY_vect and
+ * ADC_vect interrupt handlers.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+#include "AVR_eeQueue.h"
+#include "AVR_traceFormat.h"
+
+//-------------------------------------------------------------
+// How many records are gathered in RAM before being written.
+// There are two batches, so one can fill while the other is
+// written.
+//-------------------------------------------------------------
+#ifndef AVR_TRACE_BATCH
+#define AVR_TRACE_BATCH 8
+#endif
+
+
+namespace sleep {
+
+	class AVR_trace {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_trace();
+
+		//---------------------------------------------------------
+		// Start tracing to a ring of records starting at an
+		// EEPROM address. VCC is measured every vccInterval
+		// records, or never if zero. One sleep in every
+		// sampleEvery is recorded.
+		//---------------------------------------------------------
+		void begin(const uint16_t address = 0,
+		           const uint8_t records = sleep::TRACE_DEFAULT_RECORDS,
+		           const uint8_t vccInterval = 16,
+		           const uint8_t sampleEvery = 1);
+
+		//---------------------------------------------------------
+		// Write what's gathered, and stop tracing.
+		//---------------------------------------------------------
+		void end();
+
+		//---------------------------------------------------------
+		// Write what's gathered now.
+		//---------------------------------------------------------
+		void flush();
+
+		//---------------------------------------------------------
+		// Add a record. Called by AVRsleep after each sleep.
+		//---------------------------------------------------------
+		void record(const uint8_t sleepMode,
+		            const uint16_t wokenBy,
+		            const uint32_t length);
+
+		//---------------------------------------------------------
+		// The slot the next record will be written to, which is
+		// also the oldest record once the ring is full.
+		//---------------------------------------------------------
+		uint8_t position() const { return next; }
+
+		//---------------------------------------------------------
+		// Measure the supply voltage, in mV, against the 1.1V
+		// band gap reference.
+		//---------------------------------------------------------
+		static uint16_t readVcc();
+
+	private:
+		//---------------------------------------------------------
+		// Where the ring is, how big it is, and where we are.
+		//---------------------------------------------------------
+		uint16_t base;
+		uint8_t size;
+		uint8_t next;
+		uint8_t seq;
+
+		//---------------------------------------------------------
+		// The batches, the one being filled, how full it is, and
+		// the last AVReeQueue ticket for each.
+		//---------------------------------------------------------
+		traceRecord_t batches[2][AVR_TRACE_BATCH];
+		uint8_t current;
+		uint8_t fill;
+		uint8_t tickets[2];
+
+		//---------------------------------------------------------
+		// VCC sampling.
+		//---------------------------------------------------------
+		uint8_t vccEvery;
+		uint8_t vccCount;
+		uint8_t lastVcc;
+
+		//---------------------------------------------------------
+		// Sampling: record one sleep in every sampleEvery.
+		//---------------------------------------------------------
+		uint8_t sampleEvery;
+		uint8_t sampleCount;
+
+		//---------------------------------------------------------
+		// When we last woke, by AVRsleep's clock, for the time
+		// spent awake.
+		//---------------------------------------------------------
+		uint32_t wokeAt;
+		bool woken;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_trace AVRtrace;
+
+#endif // AVR_TRACE_H
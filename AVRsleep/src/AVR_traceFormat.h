@@ -0,0 +1,122 @@
+#ifndef AVR_TRACEFORMAT_H
+#define AVR_TRACEFORMAT_H
+
+/*============================================================
+ * The format of AVR_trace's EEPROM records. This header has no
+ * AVR dependencies, so the host tools in extras/tools use it
+ * to decode an EEPROM dump.
+ *
+ * Each record is four bytes:
+ *
+ *  seq        - 0 to 254, then back to 0. 0xFF is blank.
+ *  modeBucket - SMCR sleep mode bits SM2:0 in bits 7:5, and
+ *               the duration bucket in bits 4:0.
+ *  sourceAwake - The lowest numbered wake up source recorded,
+ *               a wakeSource_t, or 0x0F for none, in bits 3:0,
+ *               and the awake bucket in bits 7:4.
+ *  vcc        - The supply voltage, in 20 mV steps above
+ *               1,000 mV, or zero if not measured.
+ *
+ * The duration bucket is the number of significant bits in the
+ * sleep's length, in clock units, so bucket n covers 2^(n-1)
+ * to (2^n)-1 units, and bucket 0 is zero or no clock. The
+ * awake bucket is the same for the time awake before the
+ * sleep, up to bucket 15.
+ *
+ * The records form a ring. The oldest record follows the first
+ * break in the sequence numbers, or the first blank record.
+ * There are never more than 254 records in the ring, so there
+ * is always a break once it has wrapped around.
+ *===========================================================*/
+
+#include <stdint.h>
+
+
+namespace sleep {
+
+	typedef struct traceRecord {
+	    uint8_t seq;
+	    uint8_t modeBucket;
+	    uint8_t sourceAwake;
+	    uint8_t vcc;
+	} traceRecord_t;
+
+	const uint8_t TRACE_SEQ_BLANK = 0xFF;
+	const uint8_t TRACE_SEQ_MODULUS = 255;
+	const uint8_t TRACE_NO_SOURCE = 0x0F;
+	const uint8_t TRACE_MAX_RECORDS = 254;
+
+	//---------------------------------------------------------
+	// The default ring, from address 0, stops short of the last
+	// 32 bytes of the ATmega328P's 1K EEPROM, where AVR_profile
+	// keeps its profile by default.
+	//---------------------------------------------------------
+	const uint8_t TRACE_DEFAULT_RECORDS = 248;
+
+	//---------------------------------------------------------
+	// The sequence number after this one.
+	//---------------------------------------------------------
+	inline uint8_t traceNextSeq(const uint8_t seq) {
+		return (seq + 1) % TRACE_SEQ_MODULUS;
+	}
+
+	//---------------------------------------------------------
+	// Duration buckets.
+	//---------------------------------------------------------
+	inline uint8_t traceBucket(uint32_t length, const uint8_t most = 31) {
+		uint8_t bits = 0;
+
+		while (length) {
+		    bits++;
+		    length >>= 1;
+		}
+
+		return bits > most ? most : bits;
+	}
+
+	inline uint32_t traceBucketLow(const uint8_t bucket) {
+		return bucket ? (uint32_t)1 << (bucket - 1) : 0;
+	}
+
+	inline uint32_t traceBucketHigh(const uint8_t bucket) {
+		return bucket ? ((uint32_t)1 << bucket) - 1 : 0;
+	}
+
+	//---------------------------------------------------------
+	// Supply voltage.
+	//---------------------------------------------------------
+	inline uint8_t traceEncodeVcc(const uint16_t millivolts) {
+		if (millivolts < 1020) {
+		    return millivolts ? 1 : 0;
+		}
+
+		uint16_t steps = (millivolts - 1000) / 20;
+		return steps > 255 ? 255 : steps;
+	}
+
+	inline uint16_t traceDecodeVcc(const uint8_t vcc) {
+		return vcc ? 1000 + vcc * 20 : 0;
+	}
+
+	//---------------------------------------------------------
+	// Unpacking.
+	//---------------------------------------------------------
+	inline uint8_t traceMode(const traceRecord_t &record) {
+		return record.modeBucket >> 5;
+	}
+
+	inline uint8_t traceDuration(const traceRecord_t &record) {
+		return record.modeBucket & 0x1F;
+	}
+
+	inline uint8_t traceSource(const traceRecord_t &record) {
+		return record.sourceAwake & 0x0F;
+	}
+
+	inline uint8_t traceAwake(const traceRecord_t &record) {
+		return record.sourceAwake >> 4;
+	}
+
+} // End of namespace.
+
+#endif // AVR_TRACEFORMAT_H
@@ -0,0 +1,191 @@
+#include "AVR_twiSlave.h"
+
+//-------------------------------------------------------------
+// TWCR settings. We always ACK, and always want interrupts.
+//-------------------------------------------------------------
+#define TWCR_ACK ((1 << TWINT) | (1 << TWEA) | (1 << TWEN) | (1 << TWIE))
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_twiSlave::AVR_twiSlave() :
+		rx(nullptr),
+		tx(nullptr),
+		sp(nullptr),
+		inTransaction(false),
+		completed(0)
+		{}
+
+	//-------------------------------------------------------------
+	// Power the TWI, and keep it powered while asleep, then set
+	// our slave address and start listening. General calls are
+	// not answered.
+	//-------------------------------------------------------------
+	void AVR_twiSlave::begin(
+		    const uint8_t address,
+		    const twiReceiveFN rxfn,
+		    const twiRequestFN txfn,
+		    const twiStopFN spfn) {
+
+		rx = rxfn;
+		tx = txfn;
+		sp = spfn;
+
+		AVRsleep.writePRR(PRR & ~(1 << PRTWI));
+		AVRsleep.keepPowered(sleep::PM_TWI_OFF);
+
+		TWAR = (address << 1);
+		TWCR = TWCR_ACK;
+	}
+
+	//-------------------------------------------------------------
+	// Stop listening, and let the TWI be powered off again.
+	//-------------------------------------------------------------
+	void AVR_twiSlave::end() {
+		TWCR = 0;
+		if (inTransaction) {
+		    AVRsleep.unlock(sleep::PM_TWI_OFF);
+		}
+
+		inTransaction = false;
+		AVRsleep.allowPowerOff(sleep::PM_TWI_OFF);
+	}
+
+	//-------------------------------------------------------------
+	// A transaction is over, one way or another.
+	//-------------------------------------------------------------
+	void AVR_twiSlave::finished() {
+		if (inTransaction) {
+		    AVRsleep.unlock(sleep::PM_TWI_OFF);
+		}
+
+		inTransaction = false;
+		completed++;
+		if (sp) {
+		    (sp)();
+		}
+	}
+
+	//-------------------------------------------------------------
+	// A transaction has started. Take a lock so that goToSleep()
+	// won't go into power down, where the TWI has no clock, if it
+	// was about to when we were addressed.
+	//-------------------------------------------------------------
+	void AVR_twiSlave::started() {
+		if (!inTransaction) {
+		    AVRsleep.lock(sleep::PM_TWI_OFF);
+		}
+
+		inTransaction = true;
+	}
+
+	//-------------------------------------------------------------
+	// The slave state machine. TWSR tells us what just happened.
+	//-------------------------------------------------------------
+	void AVR_twiSlave::interrupt() {
+		switch (TWSR & 0xF8) {
+		    //-----------------------------------------------------
+		    // Addressed for writing. This is what wakes us.
+		    //-----------------------------------------------------
+		    case 0x60:  // SLA+W, ACK returned.
+		    case 0x68:  // Arbitration lost, then SLA+W.
+		        started();
+		        break;
+
+		    //-----------------------------------------------------
+		    // Data from the master.
+		    //-----------------------------------------------------
+		    case 0x80:  // Data, ACK returned.
+		        if (rx) {
+		            (rx)(TWDR);
+		        }
+		        break;
+
+		    case 0x88:  // Data, NACK returned.
+		        if (rx) {
+		            (rx)(TWDR);
+		        }
+		        finished();
+		        break;
+
+		    //-----------------------------------------------------
+		    // STOP or repeated START while addressed.
+		    //-----------------------------------------------------
+		    case 0xA0:
+		        finished();
+		        break;
+
+		    //-----------------------------------------------------
+		    // Addressed for reading, or the master wants more.
+		    //-----------------------------------------------------
+		    case 0xA8:  // SLA+R, ACK returned.
+		    case 0xB0:  // Arbitration lost, then SLA+R.
+		        started();
+		        TWDR = tx ? (tx)() : 0xFF;
+		        break;
+
+		    case 0xB8:  // Data sent, ACK received.
+		        TWDR = tx ? (tx)() : 0xFF;
+		        break;
+
+		    case 0xC0:  // Data sent, NACK received. Master is done.
+		    case 0xC8:  // Last data sent, ACK received.
+		        finished();
+		        break;
+
+		    //-----------------------------------------------------
+		    // Bus error. Release the bus and start again. It only
+		    // ends a transaction if we were in one, otherwise there
+		    // is nothing to count, or to tell the stop function.
+		    //-----------------------------------------------------
+		    case 0x00:
+		        TWCR = TWCR_ACK | (1 << TWSTO);
+		        if (inTransaction) {
+		            finished();
+		        }
+		        return;
+
+		    default:
+		        break;
+		}
+
+		TWCR = TWCR_ACK;
+	}
+
+	//-------------------------------------------------------------
+	// If a transaction is in progress, sleep in idle until it is
+	// over. Returns the number of transactions completed since
+	// the last call.
+	//-------------------------------------------------------------
+	uint8_t AVR_twiSlave::service() {
+		uint8_t oldSREG = SREG;
+		cli();
+
+		while (inTransaction) {
+		    AVRsleep.nap(sleep::SM_IDLE);
+		}
+
+		uint8_t result = completed;
+		completed = 0;
+
+		SREG = oldSREG;
+		return result;
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// The TWI interrupt handler.
+//-------------------------------------------------------------
+ISR(TWI_vect) {
+	AVRsleep.recordWake(sleep::WAKE_TWI);
+	AVRtwiSlave.interrupt();
+}
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_twiSlave object.
+//-------------------------------------------------------------
+sleep::AVR_twiSlave AVRtwiSlave;
+
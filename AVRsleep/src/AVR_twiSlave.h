@@ -0,0 +1,109 @@
+#ifndef AVR_TWISLAVE_H
+#define AVR_TWISLAVE_H
+
+/*============================================================
+ * The AVR_twiSlave class makes the board an I2C/TWI slave
+ * that sleeps in power down until its master calls. The TWI
+ * can recognise its own slave address, and wake the board,
+ * in any sleep mode, so long as it is powered. This class
+ * asks AVRsleep to keep it powered.
+ *
+ * The bytes of a transaction are handled, quickly, by the
+ * interrupt handler and the sketch's functions. As the rest
+ * of the transaction needs the TWI's clock, the board sleeps
+ * in idle until it is over, then goes back to power down.
+ *
+ * This class owns the TWI_vect interrupt handler, so it can
+ * not be used in the same sketch as the Wire library.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Called, from the interrupt handler, with each byte sent
+	// by the master.
+	//---------------------------------------------------------
+	typedef void (*twiReceiveFN)(const uint8_t data);
+
+	//---------------------------------------------------------
+	// Called, from the interrupt handler, for each byte the
+	// master wants.
+	//---------------------------------------------------------
+	typedef uint8_t (*twiRequestFN)();
+
+	//---------------------------------------------------------
+	// Called, from the interrupt handler, when a transaction
+	// is over.
+	//---------------------------------------------------------
+	typedef void (*twiStopFN)();
+
+
+	class AVR_twiSlave {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_twiSlave();
+
+		//---------------------------------------------------------
+		// Our 7 bit address, and the functions to call.
+		//---------------------------------------------------------
+		void begin(
+		        const uint8_t address,
+		        const twiReceiveFN rxfn,
+		        const twiRequestFN txfn,
+		        const twiStopFN spfn = nullptr);
+
+		//---------------------------------------------------------
+		// Stop being a slave.
+		//---------------------------------------------------------
+		void end();
+
+		//---------------------------------------------------------
+		// Are we part way through a transaction?
+		//---------------------------------------------------------
+		bool busy() const { return inTransaction; }
+
+		//---------------------------------------------------------
+		// Finish any transaction in progress. Call after waking.
+		//---------------------------------------------------------
+		uint8_t service();
+
+		//---------------------------------------------------------
+		// Called from the TWI interrupt handler only.
+		//---------------------------------------------------------
+		void interrupt();
+
+	private:
+		//---------------------------------------------------------
+		// A transaction has started/is over.
+		//---------------------------------------------------------
+		void started();
+		void finished();
+
+		//---------------------------------------------------------
+		// The functions to call.
+		//---------------------------------------------------------
+		twiReceiveFN rx;
+		twiRequestFN tx;
+		twiStopFN sp;
+
+		//---------------------------------------------------------
+		// Set by the interrupt handler.
+		//---------------------------------------------------------
+		volatile bool inTransaction;
+		volatile uint8_t completed;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_twiSlave AVRtwiSlave;
+
+#endif // AVR_TWISLAVE_H
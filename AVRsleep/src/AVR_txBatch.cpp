@@ -0,0 +1,129 @@
+#include "AVR_txBatch.h"
+
+namespace sleep {
+
+	//-------------------------------------------------------------
+	// Constructor.
+	//-------------------------------------------------------------
+	AVR_txBatch::AVR_txBatch() :
+		wr(nullptr),
+		sizeLimit(AVR_TXBATCH_SIZE),
+		ageLimit(0),
+		age(0),
+		usart(),
+		buffer(),
+		used(0)
+		{}
+
+	//-------------------------------------------------------------
+	// Save the USART settings, which must already be set up, then
+	// let it finish what it is doing and power it off. If it is
+	// powered off already, or the transmitter isn't enabled, we
+	// have no settings to send with, so we refuse, and nothing
+	// will be sent.
+	//-------------------------------------------------------------
+	bool AVR_txBatch::begin(
+		    const writeFN wfn,
+		    const uint8_t threshold,
+		    const uint8_t deadline) {
+
+		wr = nullptr;
+		sizeLimit = (threshold && threshold <= AVR_TXBATCH_SIZE) ?
+		            threshold : AVR_TXBATCH_SIZE;
+		ageLimit = deadline;
+
+		if ((PRR & (1 << PRUSART0)) || !(UCSR0B & (1 << TXEN0))) {
+		    return false;
+		}
+
+		wr = wfn;
+		usart.save();
+		AVRsleep.drainUSART();
+		AVRsleep.writePRR(PRR | (1 << PRUSART0));
+		return true;
+	}
+
+	//-------------------------------------------------------------
+	// Add a record. If it won't fit, the batch is sent first. A
+	// record bigger than the whole buffer is refused.
+	//-------------------------------------------------------------
+	bool AVR_txBatch::add(const void *data, const uint8_t length) {
+		if (length > AVR_TXBATCH_SIZE) {
+		    return false;
+		}
+
+		if (used + length > AVR_TXBATCH_SIZE) {
+		    flush();
+		}
+
+		const uint8_t *bytes = (const uint8_t *)data;
+		for (uint8_t x = 0; x < length; x++) {
+		    buffer[used++] = bytes[x];
+		}
+
+		if (used >= sizeLimit) {
+		    flush();
+		}
+
+		return true;
+	}
+
+	//-------------------------------------------------------------
+	// Age the batch by one wake up, and send it if it is too old.
+	//-------------------------------------------------------------
+	void AVR_txBatch::poll() {
+		if (!used || !ageLimit) {
+		    return;
+		}
+
+		if (++age >= ageLimit) {
+		    flush();
+		}
+	}
+
+	//-------------------------------------------------------------
+	// Power up the USART, set it up again, and send the batch in
+	// chunks that fit in the serial driver's buffer. Between
+	// chunks we sleep in idle while the driver's buffer empties.
+	// Once everything has gone, the USART is powered off again.
+	//-------------------------------------------------------------
+	void AVR_txBatch::flush() {
+		age = 0;
+		if (!used || !wr) {
+		    used = 0;
+		    return;
+		}
+
+		AVRsleep.writePRR(PRR & ~(1 << PRUSART0));
+		usart.restore();
+
+		for (uint8_t sent = 0; sent < used; ) {
+		    uint8_t chunk = used - sent;
+		    if (chunk > AVR_TXBATCH_CHUNK) {
+		        chunk = AVR_TXBATCH_CHUNK;
+		    }
+
+		    (wr)(buffer + sent, chunk);
+		    sent += chunk;
+
+		    uint8_t oldSREG = SREG;
+		    cli();
+		    while (UCSR0B & (1 << UDRIE0)) {
+		        AVRsleep.nap(sleep::SM_IDLE);
+		    }
+		    SREG = oldSREG;
+		}
+
+		used = 0;
+
+		AVRsleep.drainUSART();
+		AVRsleep.writePRR(PRR | (1 << PRUSART0));
+	}
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// And here we declare our one AVR_txBatch object.
+//-------------------------------------------------------------
+sleep::AVR_txBatch AVRtxBatch;
+
@@ -0,0 +1,113 @@
+#ifndef AVR_TXBATCH_H
+#define AVR_TXBATCH_H
+
+/*============================================================
+ * The AVR_txBatch class collects telemetry records in RAM
+ * between sleeps and sends them all at once. The USART is
+ * kept powered off in the PRR except while a batch is being
+ * sent, and the board sleeps in idle while the batch drains,
+ * so the start up overhead of many small sends is paid once.
+ *
+ * A batch is sent when it reaches a size threshold, or when
+ * its oldest record has waited for a number of wake ups.
+ *===========================================================*/
+
+#include "AVR_sleep.h"
+
+//-------------------------------------------------------------
+// The size of the batch buffer.
+//-------------------------------------------------------------
+#ifndef AVR_TXBATCH_SIZE
+#define AVR_TXBATCH_SIZE 64
+#endif
+
+//-------------------------------------------------------------
+// How much to hand to the write function at a time. This
+// should fit in the serial driver's buffer, so that writing
+// never busy waits for space.
+//-------------------------------------------------------------
+#ifndef AVR_TXBATCH_CHUNK
+#define AVR_TXBATCH_CHUNK 32
+#endif
+
+
+namespace sleep {
+
+	//---------------------------------------------------------
+	// Send some bytes. For the Arduino, Serial.write() will do.
+	//---------------------------------------------------------
+	typedef void (*writeFN)(const uint8_t *data, const uint8_t length);
+
+
+	class AVR_txBatch {
+
+	public:
+		//---------------------------------------------------------
+		// Constructor.
+		//---------------------------------------------------------
+		AVR_txBatch();
+
+		//---------------------------------------------------------
+		// Where to send, when to send. Powers off the USART, which
+		// must be powered and set up. Returns false if it isn't.
+		//---------------------------------------------------------
+		bool begin(
+		        const writeFN wfn,
+		        const uint8_t threshold = AVR_TXBATCH_SIZE,
+		        const uint8_t deadline = 0);
+
+		//---------------------------------------------------------
+		// Add a record to the batch.
+		//---------------------------------------------------------
+		bool add(const void *data, const uint8_t length);
+
+		//---------------------------------------------------------
+		// Call once per wake up. Sends the batch if it is due.
+		//---------------------------------------------------------
+		void poll();
+
+		//---------------------------------------------------------
+		// Send the batch now.
+		//---------------------------------------------------------
+		void flush();
+
+		//---------------------------------------------------------
+		// How many bytes are waiting?
+		//---------------------------------------------------------
+		uint8_t size() const { return used; }
+
+	private:
+		//---------------------------------------------------------
+		// Where to send.
+		//---------------------------------------------------------
+		writeFN wr;
+
+		//---------------------------------------------------------
+		// Send when this many bytes are waiting, or when the
+		// oldest has waited this many wake ups. Zero means no
+		// deadline.
+		//---------------------------------------------------------
+		uint8_t sizeLimit;
+		uint8_t ageLimit;
+		uint8_t age;
+
+		//---------------------------------------------------------
+		// The USART set up, saved by begin().
+		//---------------------------------------------------------
+		usartConfig_t usart;
+
+		//---------------------------------------------------------
+		// The batch.
+		//---------------------------------------------------------
+		uint8_t buffer[AVR_TXBATCH_SIZE];
+		uint8_t used;
+	};
+
+} // End of namespace.
+
+//-------------------------------------------------------------
+// We need one of these which is declared in the cpp file.
+//-------------------------------------------------------------
+extern sleep::AVR_txBatch AVRtxBatch;
+
+#endif // AVR_TXBATCH_H